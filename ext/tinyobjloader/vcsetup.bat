@@ -1 +0,0 @@
-.\\tools\\windows\\premake5.exe vs2013
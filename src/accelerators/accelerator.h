@@ -0,0 +1,75 @@
+#ifndef ACCELERATOR_H
+#define ACCELERATOR_H
+
+#include <string>
+#include "common.h"
+#include "ray.h"
+
+/** Acceleration structures of the meshes, selected with the property
+ * <string name="accelerator" value="..."/> ("bvh", "kdtree" or "bruteforce").
+ *
+ * BVH and KDTree share the same interface, over primitives given by their
+ * bounding boxes:
+ *   - build(bounds, params) builds the structure, the i-th box being the one
+ *     of the primitive i;
+ *   - intersect(ray, hit, intersectPrimitive) and
+ *     occluded(ray, tMax, occludedByPrimitive) traverse it and call the
+ *     function object for the primitives of the visited leaves, given by
+ *     their position in the primitive order of the structure;
+ *   - primitiveId(i) and primitiveIds() map these positions to primitives;
+ *   - getBoundingBox(), nbPrimitives() and memoryUsage().
+ * The traversals are templates rather than virtual functions, so that the
+ * primitive tests are inlined in the traversal loops. The meshes wrap each
+ * structure, with its primitive tests, in a TriangleAccelerator.
+ */
+enum EAccelerator { EBVHAccelerator, EKDTreeAccelerator, EBruteForce };
+
+/// Parses an accelerator name ("bvh", "kdtree" or "bruteforce")
+inline EAccelerator acceleratorFromString(const std::string &name) {
+  std::string value = toLower(name);
+  if (value == "bvh")
+    return EBVHAccelerator;
+  if (value == "kdtree")
+    return EKDTreeAccelerator;
+  if (value == "bruteforce" || value == "none")
+    return EBruteForce;
+  throw RTException("Unknown accelerator \"%s\" (expected \"bvh\", "
+                    "\"kdtree\" or \"bruteforce\")",
+                    name);
+}
+
+inline std::string acceleratorName(EAccelerator accelerator) {
+  switch (accelerator) {
+  case EKDTreeAccelerator:
+    return "kdtree";
+  case EBruteForce:
+    return "bruteforce";
+  default:
+    return "bvh";
+  }
+}
+
+/** Ray queries against the triangles of a mesh, answered by one of the
+ * acceleration structures (see Mesh::buildAccelerator()). As with
+ * Shape::intersect(), the hits only record the distance, the primitive id
+ * and the barycentric coordinates. */
+class TriangleAccelerator {
+public:
+  virtual ~TriangleAccelerator() {}
+
+  /// Nearest hit closer than \a hit.t, see Shape::intersect()
+  virtual bool intersect(const Ray &ray, Hit &hit) const = 0;
+
+  /// Nearest hits of the lanes selected by \a mask, see Shape::intersectPacket()
+  virtual void intersectPacket(const RayPacket &packet, uint32_t mask,
+                               Hit *hits) const = 0;
+
+  /// \returns true if any triangle is hit before \a tMax
+  virtual bool occluded(const Ray &ray, float tMax) const = 0;
+
+  /// Any hits of the rays rays[ids[k]], see Shape::occludedStream()
+  virtual void occludedStream(const Ray *rays, const int *ids, int count,
+                              bool *isOccluded) const = 0;
+};
+
+#endif
@@ -300,20 +300,27 @@ template <typename _PointType> struct TBoundingBox {
 
   /// Check if a ray intersects a bounding box
   bool rayIntersect(const Ray &ray) const {
-    float nearT = -std::numeric_limits<float>::infinity();
-    float farT = std::numeric_limits<float>::infinity();
+    float nearT, farT;
     return rayIntersect(ray, nearT, farT);
   }
 
-  /// Return the overlapping region of the bounding box and an unbounded ray
+  /** Return the overlapping region of the bounding box and the interval
+   * [tMin, tMax] of the ray. Uses the cached inverse direction and signs of
+   * the ray; an axis giving NaN (ray in the plane of a slab) is ignored. */
   bool rayIntersect(const Ray &ray, float &nearT, float &farT) const {
-    Eigen::Array3f t1, t2;
-    t1 = (min - ray.origin).cwiseQuotient(ray.direction);
-    t2 = (max - ray.origin).cwiseQuotient(ray.direction);
-    Eigen::Array3f::Index maxIdx, minIdx;
-    nearT = t1.min(t2).maxCoeff(&maxIdx);
-    farT = t1.max(t2).minCoeff(&minIdx);
-    return farT > 0 && nearT <= farT;
+    nearT = ray.tMin;
+    farT = ray.tMax;
+    for (int i = 0; i < 3; ++i) {
+      float t1 = ((ray.sign[i] ? max : min)[i] - ray.origin[i]) *
+                 ray.invDirection[i];
+      float t2 = ((ray.sign[i] ? min : max)[i] - ray.origin[i]) *
+                 ray.invDirection[i];
+      if (t1 > nearT)
+        nearT = t1;
+      if (t2 < farT)
+        farT = t2;
+    }
+    return nearT <= farT;
   }
 
   PointType min; ///< Component-wise minimum
@@ -1,128 +1,741 @@
 #include "accelerators/bvh.h"
-#include "shapes/mesh.h"
 
 #include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <iostream>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_invoke.h>
+#include <tbb/parallel_reduce.h>
 
-void BVH::build(const Mesh *pMesh, int targetCellSize, int maxDepth) {
-  m_splitMethod = SPLIT_MIDDLE;
-  m_pMesh = pMesh;
-  m_nodes.resize(1);
-  if (m_pMesh->nbFaces() <= targetCellSize) {
-    m_nodes[0].box = pMesh->getBoundingBox();
-    m_nodes[0].first_face_id = 0;
-    m_nodes[0].is_leaf = true;
-    m_nodes[0].nb_faces = m_pMesh->nbFaces();
-    m_faces.resize(m_pMesh->nbFaces());
-    for (int i = 0; i < m_pMesh->nbFaces(); ++i) {
-      m_faces[i] = i;
+/* Below these numbers of primitives, the work is done sequentially as the
+ * overhead of the TBB tasks outweighs the gain */
+static const int ParallelReduceThreshold = 1 << 16;
+static const int ParallelSubtreeThreshold = 1 << 12;
+static const int ParallelGrainSize = 1 << 14;
+
+/* Spatial splits are only searched in the nodes where the children of the
+ * best object split overlap by more than this fraction of the root area */
+static const float SpatialSplitAlpha = 1e-5f;
+
+/* The children of the wide nodes of the first levels are refitted as
+ * independent tasks */
+static const int ParallelRefitLevels = 3;
+
+/* Bits per axis of the Morton codes of the linear construction, and number
+ * of their first bits shared by the primitives of a cluster of SPLIT_HLBVH */
+static const int MortonAxisBits = 21;
+static const int HLBVHClusterBits = 12;
+
+// box surface area = 2lw + 2lh + 2wh
+float surfaceArea(const BoundingBox3f &aabb) {
+  Vector3f diag = aabb.getExtents();
+  return 2.f * (diag[0] * diag[1] + diag[0] * diag[2] + diag[1] * diag[2]);
+}
+
+BVH::SplitMethod BVH::splitMethodFromString(const std::string &name) {
+  std::string value = toLower(name);
+  if (value == "middle")
+    return SPLIT_MIDDLE;
+  if (value == "equal" || value == "equalcounts")
+    return SPLIT_EQUAL_COUNTS;
+  if (value == "sah")
+    return SPLIT_SAH;
+  if (value == "sbvh")
+    return SPLIT_SBVH;
+  if (value == "lbvh")
+    return SPLIT_LBVH;
+  if (value == "hlbvh")
+    return SPLIT_HLBVH;
+  throw RTException("BVH: unknown split method \"%s\" (expected \"middle\", "
+                    "\"equal\", \"sah\", \"sbvh\", \"lbvh\" or \"hlbvh\")",
+                    name);
+}
+
+std::string BVH::splitMethodName(SplitMethod method) {
+  switch (method) {
+  case SPLIT_MIDDLE:
+    return "middle";
+  case SPLIT_EQUAL_COUNTS:
+    return "equal";
+  case SPLIT_SBVH:
+    return "sbvh";
+  case SPLIT_LBVH:
+    return "lbvh";
+  case SPLIT_HLBVH:
+    return "hlbvh";
+  default:
+    return "sah";
+  }
+}
+
+void BVH::build(const std::vector<BoundingBox3f> &bounds,
+                const BuildParams &params,
+                const PrimitiveSplitter &splitPrimitive) {
+  m_params = params;
+  m_splitPrimitive = splitPrimitive;
+  if (m_params.splitMethod == SPLIT_SBVH && !m_splitPrimitive)
+    throw RTException("BVH: spatial splits require a primitive splitter");
+  if (m_params.nbBins < 2)
+    m_params.nbBins = 2;
+  if (m_params.targetCellSize < 1)
+    m_params.targetCellSize = 1;
+  if (m_params.leafAlignment < 1)
+    m_params.leafAlignment = 1;
+  m_params.maxDepth = std::min(m_params.maxDepth, StackSize);
+  if (m_params.width != 2 && m_params.width != 4 && m_params.width != 8)
+    throw RTException("BVH: unsupported width %i (expected 2, 4 or 8)",
+                      m_params.width);
+  if (m_params.quantization != 0 && m_params.quantization != 8 &&
+      m_params.quantization != 16)
+    throw RTException("BVH: unsupported quantization on %i bits (expected 0, "
+                      "8 or 16)",
+                      m_params.quantization);
+  if (m_params.quantization != 0 && m_params.width == 2)
+    throw RTException("BVH: quantized nodes require a width of 4 or 8");
+  int nbPrimitives = bounds.size();
+  m_nbPrimitives = nbPrimitives;
+  m_buildSahCost = 0.f;
+  m_nodes.clear();
+  m_nodes4.clear();
+  m_nodes8.clear();
+  m_nodes4q8.clear();
+  m_nodes4q16.clear();
+  m_nodes8q8.clear();
+  m_nodes8q16.clear();
+  m_bbox.reset();
+  m_faces.resize(nbPrimitives);
+  m_nbSplitReferences = 0;
+  if (nbPrimitives == 0)
+    return;
+  // the spatial splits may reference a primitive from several leaves
+  bool spatialSplits = m_params.splitMethod == SPLIT_SBVH;
+  int maxReferences = nbPrimitives;
+  if (spatialSplits)
+    maxReferences += int(std::max(0.f, m_params.splitBudget) * nbPrimitives);
+  // a binary tree with non-empty leaves has at most 2n-1 nodes: the pool is
+  // allocated once so that the subtrees can be built concurrently
+  NodeList tree(2 * maxReferences - 1);
+  m_nbNodes = 1;
+  m_bounds = bounds;
+  if (spatialSplits) {
+    ReferenceList refs(nbPrimitives);
+    BoundingBox3f rootBox;
+    for (int i = 0; i < nbPrimitives; ++i) {
+      refs[i] = {m_bounds[i], i};
+      rootBox.expandBy(m_bounds[i]);
     }
+    m_rootArea = surfaceArea(rootBox);
+    m_faces.resize(maxReferences);
+    m_nbReferences = 0;
+    m_splitBudget = maxReferences - nbPrimitives;
+    buildSpatialNode(tree, 0, refs, 0);
+    m_faces.resize(m_nbReferences);
+    m_nbSplitReferences = m_nbReferences - nbPrimitives;
   } else {
-    m_nodes.reserve(std::min<int>(
-        2 << maxDepth, std::log(m_pMesh->nbFaces() / targetCellSize)));
-    // compute centroids and initialize the face list
-    m_centroids.resize(m_pMesh->nbFaces());
-    m_faces.resize(m_pMesh->nbFaces());
-    for (int i = 0; i < m_pMesh->nbFaces(); ++i) {
-      m_centroids[i] = (m_pMesh->vertexOfFace(i, 0).position +
-                        m_pMesh->vertexOfFace(i, 1).position +
-                        m_pMesh->vertexOfFace(i, 2).position) /
-                       3.f;
-      m_faces[i] = i;
-    }
-    buildNode(0, 0, m_pMesh->nbFaces(), 0, targetCellSize, maxDepth);
+    // compute centroids
+    m_centroids.resize(nbPrimitives);
+    tbb::parallel_for(
+        tbb::blocked_range<int>(0, nbPrimitives, ParallelGrainSize),
+        [&](const tbb::blocked_range<int> &range) {
+          for (int i = range.begin(); i < range.end(); ++i) {
+            m_faces[i] = i;
+            m_centroids[i] = m_bounds[i].getCenter();
+          }
+        });
+    if (m_params.splitMethod == SPLIT_LBVH ||
+        m_params.splitMethod == SPLIT_HLBVH)
+      buildMorton(tree);
+    else
+      buildNode(tree, 0, 0, nbPrimitives, 0);
+  }
+
+  // the subtrees were allocated in any order by the tasks: linearize the tree
+  // in depth-first order for the traversal
+  m_nodes.resize(m_nbNodes);
+  std::vector<int> faces;
+  faces.swap(m_faces);
+  m_faces.reserve(nbPrimitives);
+  flattenNode(tree, faces, 0, 0);
+  m_bbox = m_nodes[0].box;
+
+  m_faces.shrink_to_fit();
+
+  if (m_params.width == 4) {
+    collapseNode(m_nodes4, 0);
+    m_nodes4.shrink_to_fit();
+  } else if (m_params.width == 8) {
+    collapseNode(m_nodes8, 0);
+    m_nodes8.shrink_to_fit();
+  }
+  if (m_params.width != 2)
+    NodeList().swap(m_nodes);
+
+  switch (m_params.width * 100 + m_params.quantization) {
+  case 408:
+    quantizeNodes(m_nodes4, m_nodes4q8);
+    break;
+  case 416:
+    quantizeNodes(m_nodes4, m_nodes4q16);
+    break;
+  case 808:
+    quantizeNodes(m_nodes8, m_nodes8q8);
+    break;
+  case 816:
+    quantizeNodes(m_nodes8, m_nodes8q16);
+    break;
   }
+  if (m_params.quantization != 0) {
+    WideNodeList<4>().swap(m_nodes4);
+    WideNodeList<8>().swap(m_nodes8);
+  }
+
+  // the build-only arrays are released
+  std::vector<Point3f>().swap(m_centroids);
+  std::vector<BoundingBox3f>().swap(m_bounds);
+  std::vector<uint64_t>().swap(m_mortonCodes);
+
+  m_buildSahCost = sahCost();
 }
 
-bool BVH::intersect(const Ray &ray, Hit &hit) const {
-  float tMin, tMax;
-  m_nodes[0].box.rayIntersect(ray, tMin, tMax);
-  if (tMax > 0 && tMax >= tMin && tMin < hit.t)
-    return intersectNode(0, ray, hit);
-  return false;
+float BVH::refit(const std::vector<BoundingBox3f> &bounds) {
+  if (int(bounds.size()) != m_nbPrimitives)
+    throw RTException("BVH::refit: %i bounds given for %i primitives",
+                      bounds.size(), m_nbPrimitives);
+  switch (m_params.width * 100 + m_params.quantization) {
+  case 400:
+    m_bbox = refitWide(m_nodes4, 0, bounds, 0);
+    break;
+  case 408:
+    m_bbox = refitWide(m_nodes4q8, 0, bounds, 0);
+    break;
+  case 416:
+    m_bbox = refitWide(m_nodes4q16, 0, bounds, 0);
+    break;
+  case 800:
+    m_bbox = refitWide(m_nodes8, 0, bounds, 0);
+    break;
+  case 808:
+    m_bbox = refitWide(m_nodes8q8, 0, bounds, 0);
+    break;
+  case 816:
+    m_bbox = refitWide(m_nodes8q16, 0, bounds, 0);
+    break;
+  default:
+    if (!m_nodes.empty())
+      m_bbox = refitBinary(0, m_nodes.size(), bounds);
+  }
+  if (m_buildSahCost <= 0.f)
+    return 1.f;
+  return sahCost() / m_buildSahCost;
 }
 
-bool BVH::intersectNode(int nodeId, const Ray &ray, Hit &hit) const {
-  const Node &node = m_nodes[nodeId];
+bool BVH::update(const std::vector<BoundingBox3f> &bounds, float &degradation,
+                 const PrimitiveSplitter &splitPrimitive) {
+  degradation = refit(bounds);
+  if (degradation <= m_params.rebuildThreshold)
+    return false;
+  build(bounds, m_params, splitPrimitive);
+  return true;
+}
+
+BoundingBox3f BVH::leafBounds(const std::vector<BoundingBox3f> &bounds,
+                              int first, int count) const {
+  // the references of the spatial splits get back the whole primitive bounds
+  BoundingBox3f box;
+  for (int i = first; i < first + count; ++i)
+    box.expandBy(bounds[m_faces[i]]);
+  return box;
+}
 
+BoundingBox3f BVH::refitBinary(int nodeId, int end,
+                               const std::vector<BoundingBox3f> &bounds) {
+  Node &node = m_nodes[nodeId];
   if (node.is_leaf) {
-    int end = node.first_child_id + node.nb_faces;
-    bool found = false;
-    for (int i = node.first_child_id; i < end; ++i) {
-      found = found | m_pMesh->intersectFace(ray, hit, m_faces[i]);
+    node.box = leafBounds(bounds, node.first_face_id, node.nb_faces);
+    return node.box;
+  }
+  int second = node.second_child_id;
+  BoundingBox3f left, right;
+  if (end - nodeId >= ParallelSubtreeThreshold) {
+    tbb::parallel_invoke(
+        [&] { left = refitBinary(nodeId + 1, second, bounds); },
+        [&] { right = refitBinary(second, end, bounds); });
+  } else {
+    left = refitBinary(nodeId + 1, second, bounds);
+    right = refitBinary(second, end, bounds);
+  }
+  node.box = BoundingBox3f::merge(left, right);
+  return node.box;
+}
+
+template <typename WideNodes>
+BoundingBox3f BVH::refitWide(WideNodes &nodes, int nodeId,
+                             const std::vector<BoundingBox3f> &bounds,
+                             int level) {
+  constexpr int N = WideNodes::value_type::Width;
+  if (nodes.empty())
+    return BoundingBox3f();
+  // the nodes are not reallocated: the children can be refitted concurrently
+  auto &node = nodes[nodeId];
+  BoundingBox3f childBounds[N];
+  auto refitChild = [&](int i) {
+    if (node.nb_faces[i] > 0)
+      childBounds[i] = leafBounds(bounds, node.child[i], node.nb_faces[i]);
+    else if (node.nb_faces[i] == 0)
+      childBounds[i] = refitWide(nodes, node.child[i], bounds, level + 1);
+  };
+  if (level < ParallelRefitLevels) {
+    tbb::parallel_for(0, N, refitChild);
+  } else {
+    for (int i = 0; i < N; ++i)
+      refitChild(i);
+  }
+
+  WideNode<N> exact;
+  BoundingBox3f box;
+  for (int i = 0; i < N; ++i) {
+    exact.child[i] = node.child[i];
+    exact.nb_faces[i] = node.nb_faces[i];
+    for (int dim = 0; dim < 3; ++dim) {
+      exact.boxMin[dim][i] = childBounds[i].min[dim];
+      exact.boxMax[dim][i] = childBounds[i].max[dim];
+    }
+    box.expandBy(childBounds[i]);
+  }
+  encodeNode(exact, node);
+  return box;
+}
+
+float BVH::sahCost() const {
+  switch (m_params.width * 100 + m_params.quantization) {
+  case 400:
+    return wideSahCost(m_nodes4);
+  case 408:
+    return wideSahCost(m_nodes4q8);
+  case 416:
+    return wideSahCost(m_nodes4q16);
+  case 800:
+    return wideSahCost(m_nodes8);
+  case 808:
+    return wideSahCost(m_nodes8q8);
+  case 816:
+    return wideSahCost(m_nodes8q16);
+  }
+  if (m_nodes.empty())
+    return 0.f;
+  const int align = m_params.leafAlignment;
+  double cost = 0.;
+  for (const Node &node : m_nodes) {
+    if (node.is_leaf)
+      cost += (node.nb_faces + align - 1) / align * surfaceArea(node.box);
+    else
+      cost += m_params.traversalCost * surfaceArea(node.box);
+  }
+  float rootArea = surfaceArea(m_nodes[0].box);
+  return rootArea > 0.f ? cost / rootArea : cost;
+}
+
+template <typename WideNodes>
+float BVH::wideSahCost(const WideNodes &nodes) const {
+  typedef typename WideNodes::value_type WideNodeType;
+  typedef typename WideNodeType::Lanes Lanes;
+  constexpr int N = WideNodeType::Width;
+  const int align = m_params.leafAlignment;
+  double cost = 0.;
+  float rootArea = 0.f;
+  for (size_t n = 0; n < nodes.size(); ++n) {
+    const WideNodeType &node = nodes[n];
+    Lanes lower[3], upper[3];
+    for (int dim = 0; dim < 3; ++dim)
+      node.childBounds(dim, lower[dim], upper[dim]);
+    // a wide node is traversed at once, its leaves are tested
+    BoundingBox3f box;
+    for (int i = 0; i < N; ++i) {
+      if (node.nb_faces[i] < 0)
+        continue;
+      BoundingBox3f child(Point3f(lower[0][i], lower[1][i], lower[2][i]),
+                          Point3f(upper[0][i], upper[1][i], upper[2][i]));
+      box.expandBy(child);
+      if (node.nb_faces[i] > 0)
+        cost += (node.nb_faces[i] + align - 1) / align * surfaceArea(child);
+    }
+    cost += m_params.traversalCost * surfaceArea(box);
+    if (n == 0)
+      rootArea = surfaceArea(box);
+  }
+  return rootArea > 0.f ? cost / rootArea : cost;
+}
+
+bool BVH::cull(const Frustum &frustum, int maxRoots,
+               std::vector<int> &roots) const {
+  roots.clear();
+  if (m_params.width != 2)
+    return false;
+  if (m_nodes.empty() ||
+      frustum.classify(m_nodes[0].box) == Frustum::EOutside)
+    return true;
+
+  // nodes [next, end) of the queue are still to open
+  std::vector<int> queue(1, 0);
+  size_t next = 0;
+  long int nbVisited = 1;
+  while (next < queue.size()) {
+    int nodeId = queue[next++];
+    const Node &node = m_nodes[nodeId];
+    if (node.is_leaf || frustum.classify(node.box) == Frustum::EInside) {
+      roots.push_back(nodeId);
+      continue;
+    }
+    int visible[2];
+    int nbVisible = 0;
+    for (int childId : {nodeId + 1, node.second_child_id}) {
+      ++nbVisited;
+      if (frustum.classify(m_nodes[childId].box) != Frustum::EOutside)
+        visible[nbVisible++] = childId;
+    }
+    // keep the node as a root when opening it exceeds the budget
+    int nbPending = queue.size() - next;
+    if (int(roots.size()) + nbPending + nbVisible > maxRoots) {
+      roots.push_back(nodeId);
+      continue;
+    }
+    queue.insert(queue.end(), visible, visible + nbVisible);
+  }
+  RayStats::local().nodesVisited += nbVisited;
+
+  // the rays leave the apex: the subtrees are sorted from front to back so
+  // that the nearest hits found first prune the farther ones
+  std::vector<std::pair<float, int>> sorted;
+  for (int nodeId : roots)
+    sorted.emplace_back(
+        m_nodes[nodeId].box.squaredDistanceTo(frustum.origin()), nodeId);
+  std::sort(sorted.begin(), sorted.end());
+  for (size_t i = 0; i < sorted.size(); ++i)
+    roots[i] = sorted[i].second;
+  return true;
+}
+
+size_t BVH::memoryUsage() const {
+  return m_nodes.capacity() * sizeof(Node) +
+         m_nodes4.capacity() * sizeof(WideNode<4>) +
+         m_nodes8.capacity() * sizeof(WideNode<8>) +
+         m_nodes4q8.capacity() * sizeof(QuantizedNode<4, uint8_t>) +
+         m_nodes4q16.capacity() * sizeof(QuantizedNode<4, uint16_t>) +
+         m_nodes8q8.capacity() * sizeof(QuantizedNode<8, uint8_t>) +
+         m_nodes8q16.capacity() * sizeof(QuantizedNode<8, uint16_t>) +
+         m_faces.capacity() * sizeof(int);
+}
+
+template <int N, typename Q>
+void BVH::encodeNode(const WideNode<N> &node, QuantizedNode<N, Q> &qnode) {
+  const int maxQ = std::numeric_limits<Q>::max();
+  const float inf = std::numeric_limits<float>::infinity();
+  for (int i = 0; i < N; ++i) {
+    qnode.child[i] = node.child[i];
+    qnode.nb_faces[i] = node.nb_faces[i];
+  }
+  for (int dim = 0; dim < 3; ++dim) {
+    // bounds of the node, i.e. of its non-empty children
+    float lower = inf, upper = -inf;
+    for (int i = 0; i < N; ++i) {
+      if (node.nb_faces[i] >= 0) {
+        lower = std::min(lower, node.boxMin[dim][i]);
+        upper = std::max(upper, node.boxMax[dim][i]);
+      }
+    }
+    // the decoded values may differ by one ulp from the ones computed here
+    // (e.g. with fused multiply-adds): the bounds are rounded outwards
+    // with that margin
+    float target = std::nextafter(upper, inf);
+    float scale = (target - lower) / maxQ;
+    while (lower + maxQ * scale < target)
+      scale = std::max(scale * (1.f + 0x1p-16f), std::nextafter(scale, inf));
+    qnode.origin[dim] = lower;
+    qnode.scale[dim] = scale;
+    auto decode = [&](int q) { return lower + q * scale; };
+
+    for (int i = 0; i < N; ++i) {
+      if (node.nb_faces[i] < 0) {
+        qnode.boxMin[dim][i] = maxQ;
+        qnode.boxMax[dim][i] = 0;
+        continue;
+      }
+      float childMin = node.boxMin[dim][i];
+      float childMax = node.boxMax[dim][i];
+      int qMin = int(
+          clamp(std::floor((childMin - lower) / scale), 0.f, float(maxQ)));
+      while (qMin > 0 && !(decode(qMin) <= std::nextafter(childMin, -inf)))
+        --qMin;
+      int qMax = int(
+          clamp(std::ceil((childMax - lower) / scale), 0.f, float(maxQ)));
+      while (qMax < maxQ && !(decode(qMax) >= std::nextafter(childMax, inf)))
+        ++qMax;
+      qnode.boxMin[dim][i] = qMin;
+      qnode.boxMax[dim][i] = qMax;
     }
-    return found;
+  }
+}
+
+template <int N, typename Q>
+void BVH::quantizeNodes(const WideNodeList<N> &nodes,
+                        QuantizedNodeList<N, Q> &quantized) {
+  quantized.resize(nodes.size());
+  tbb::parallel_for(tbb::blocked_range<int>(0, nodes.size()),
+                    [&](const tbb::blocked_range<int> &range) {
+                      for (int n = range.begin(); n < range.end(); ++n)
+                        encodeNode(nodes[n], quantized[n]);
+                    });
+}
+
+int BVH::flattenNode(const NodeList &tree, const std::vector<int> &faces,
+                     int nodeId, int offset) {
+  const Node &node = tree[nodeId];
+  m_nodes[offset] = node;
+  if (node.is_leaf) {
+    int first = m_faces.size();
+    m_nodes[offset].first_face_id = first;
+    m_faces.insert(m_faces.end(), faces.begin() + node.first_face_id,
+                   faces.begin() + node.first_face_id + node.nb_faces);
+    while (m_faces.size() % m_params.leafAlignment != 0)
+      m_faces.push_back(m_faces.back());
+    return offset + 1;
+  }
+  int second = flattenNode(tree, faces, node.second_child_id - 1, offset + 1);
+  m_nodes[offset].second_child_id = second;
+  return flattenNode(tree, faces, node.second_child_id, second);
+}
+
+template <int N> int BVH::collapseNode(WideNodeList<N> &nodes, int nodeId) {
+  const Node &node = m_nodes[nodeId];
+  int children[N];
+  int count = 0;
+  if (node.is_leaf) {
+    children[count++] = nodeId;
   } else {
-    float tMin1, tMax1, tMin2, tMax2;
-    int child_id1 = node.first_child_id;
-    int child_id2 = node.first_child_id + 1;
-    m_nodes[child_id1].box.rayIntersect(ray, tMin1, tMax1);
-    m_nodes[child_id2].box.rayIntersect(ray, tMin2, tMax2);
-    if (tMin1 > tMin2) {
-      std::swap(tMin1, tMin2);
-      std::swap(tMax1, tMax2);
-      std::swap(child_id1, child_id2);
+    children[count++] = nodeId + 1;
+    children[count++] = node.second_child_id;
+  }
+  // open the inner child of largest area until there are N children
+  while (count < N) {
+    int best = -1;
+    float bestArea = -1.f;
+    for (int i = 0; i < count; ++i) {
+      const Node &child = m_nodes[children[i]];
+      if (!child.is_leaf && surfaceArea(child.box) > bestArea) {
+        best = i;
+        bestArea = surfaceArea(child.box);
+      }
     }
+    if (best < 0)
+      break;
+    int opened = children[best];
+    children[best] = opened + 1;
+    children[count++] = m_nodes[opened].second_child_id;
+  }
 
-    if (tMin1 < hit.t && tMin1 <= tMax1 && tMax1 > 0) {
-      intersectNode(child_id1, ray, hit);
+  int wideId = nodes.size();
+  nodes.emplace_back();
+  for (int i = 0; i < N; ++i) {
+    // nodes may be reallocated by the recursive calls
+    WideNode<N> &wide = nodes[wideId];
+    if (i >= count) {
+      for (int dim = 0; dim < 3; ++dim) {
+        wide.boxMin[dim][i] = std::numeric_limits<float>::infinity();
+        wide.boxMax[dim][i] = -std::numeric_limits<float>::infinity();
+      }
+      wide.child[i] = 0;
+      wide.nb_faces[i] = -1;
+      continue;
     }
-    if (tMin2 < hit.t && tMin2 <= tMax2 && tMax2 > 0) {
-      intersectNode(child_id2, ray, hit);
+    const Node &child = m_nodes[children[i]];
+    for (int dim = 0; dim < 3; ++dim) {
+      wide.boxMin[dim][i] = child.box.min[dim];
+      wide.boxMax[dim][i] = child.box.max[dim];
+    }
+    if (child.is_leaf) {
+      wide.child[i] = child.first_face_id;
+      wide.nb_faces[i] = child.nb_faces;
+    } else {
+      wide.nb_faces[i] = 0;
+      int childId = collapseNode(nodes, children[i]);
+      nodes[wideId].child[i] = childId;
     }
   }
-  return false;
+  return wideId;
 }
 
 /** Sorts the faces with respect to their centroid along the dimension \a dim
  * and spliting value \a split_value. \returns the middle index
  */
 int BVH::split(int start, int end, int dim, float split_value) {
-  int l(start), r(end - 1);
-  while (l < r) {
-    // find the first on the left
-    while (l < end && m_centroids[l](dim) < split_value)
-      ++l;
-    while (r >= start && m_centroids[r](dim) >= split_value)
-      --r;
-    if (l > r)
-      break;
-    std::swap(m_centroids[l], m_centroids[r]);
-    std::swap(m_faces[l], m_faces[r]);
-    ++l;
-    --r;
-  }
-  return m_centroids[l][dim] < split_value ? l + 1 : l;
+  return std::partition(m_faces.begin() + start, m_faces.begin() + end,
+                        [&](int f) { return m_centroids[f][dim] < split_value; }) -
+         m_faces.begin();
 }
 
-// box surface area = 2lw + 2lh + 2wh
-float surfaceArea(BoundingBox3f &aabb) {
-  Vector3f diag = aabb.getExtents();
-  return 2.f * (diag[0] * diag[1] + diag[0] * diag[2] + diag[1] * diag[2]);
+/** Reduces the boxes returned by \a getBox(faceId) over the faces
+ * [start, end), in parallel for large ranges */
+template <typename GetBox>
+static BoundingBox3f reduceBounds(const std::vector<int> &faces, int start,
+                                  int end, const GetBox &getBox) {
+  auto expand = [&](const tbb::blocked_range<int> &range,
+                    BoundingBox3f aabb) {
+    for (int i = range.begin(); i < range.end(); ++i)
+      aabb.expandBy(getBox(faces[i]));
+    return aabb;
+  };
+  if (end - start < ParallelReduceThreshold)
+    return expand(tbb::blocked_range<int>(start, end), BoundingBox3f());
+  return tbb::parallel_reduce(
+      tbb::blocked_range<int>(start, end, ParallelGrainSize), BoundingBox3f(),
+      expand, [](BoundingBox3f a, const BoundingBox3f &b) {
+        a.expandBy(b);
+        return a;
+      });
 }
 
-void BVH::buildNode(int nodeId, int start, int end, int level,
-                    int targetCellSize, int maxDepth) {
-  Node &node = m_nodes[nodeId];
+BoundingBox3f BVH::computeBounds(int start, int end) const {
+  return reduceBounds(m_faces, start, end,
+                      [&](int f) -> const BoundingBox3f & { return m_bounds[f]; });
+}
 
-  // compute bounding box
-  BoundingBox3f aabb;
-  aabb.reset();
-  for (int i = start; i < end; ++i) {
-    // Attention pas m_pMesh->vertexOfFace(i, ...)
-    aabb.expandBy(m_pMesh->vertexOfFace(m_faces[i], 0).position);
-    aabb.expandBy(m_pMesh->vertexOfFace(m_faces[i], 1).position);
-    aabb.expandBy(m_pMesh->vertexOfFace(m_faces[i], 2).position);
+BoundingBox3f BVH::computeCentroidBounds(int start, int end) const {
+  return reduceBounds(m_faces, start, end, [&](int f) {
+    return BoundingBox3f(m_centroids[f]);
+  });
+}
+
+bool BVH::splitSAH(int start, int end, const BoundingBox3f &aabb,
+                   int &mid_id, int &axis) {
+  const int nBuckets = m_params.nbBins;
+  int count = end - start;
+
+  // Bin the centroids, not the primitive bounds
+  BoundingBox3f centroidBox = computeCentroidBounds(start, end);
+  Vector3f extents = centroidBox.getExtents();
+  Vector3f scale;
+  for (int dim = 0; dim < 3; ++dim)
+    scale[dim] = extents[dim] > 0.f ? nBuckets / extents[dim] : 0.f;
+
+  // The three axes are binned in a single pass over the faces
+  auto binFaces = [&](const tbb::blocked_range<int> &range,
+                      std::vector<BucketInfo> buckets) {
+    for (int i = range.begin(); i < range.end(); ++i) {
+      int f = m_faces[i];
+      for (int dim = 0; dim < 3; ++dim) {
+        if (scale[dim] == 0.f)
+          continue;
+        int b = std::min(nBuckets - 1,
+                         int((m_centroids[f][dim] - centroidBox.min[dim]) *
+                             scale[dim]));
+        BucketInfo &bucket = buckets[dim * nBuckets + b];
+        bucket.count++;
+        bucket.bounds.expandBy(m_bounds[f]);
+      }
+    }
+    return buckets;
+  };
+  std::vector<BucketInfo> buckets;
+  if (count < ParallelReduceThreshold) {
+    buckets = binFaces(tbb::blocked_range<int>(start, end),
+                       std::vector<BucketInfo>(3 * nBuckets));
+  } else {
+    buckets = tbb::parallel_reduce(
+        tbb::blocked_range<int>(start, end, ParallelGrainSize),
+        std::vector<BucketInfo>(3 * nBuckets), binFaces,
+        [](std::vector<BucketInfo> a, const std::vector<BucketInfo> &b) {
+          for (size_t i = 0; i < a.size(); ++i) {
+            a[i].count += b[i].count;
+            a[i].bounds.expandBy(b[i].bounds);
+          }
+          return a;
+        });
   }
+
+  // Costs are relative to the cost of intersecting one primitive, and scaled
+  // by the surface area of the node (which may be zero for flat primitives)
+  float mainSA = surfaceArea(aabb);
+  // when the primitives are tested by packs, a leaf costs its number of packs
+  const int align = m_params.leafAlignment;
+  auto nbPacks = [&](int n) { return float((n + align - 1) / align); };
+  float leafCost = nbPacks(count) * mainSA;
+  float minCost = std::numeric_limits<float>::infinity();
+  int minCostDim = -1, minCostSplit = 0;
+
+  std::vector<float> cost(nBuckets - 1);
+  for (int dim = 0; dim < 3; ++dim) {
+    if (scale[dim] == 0.f)
+      continue;
+    const BucketInfo *axisBuckets = &buckets[dim * nBuckets];
+
+    // Sweep from the left, then from the right, to get the cost of the
+    // nBuckets-1 splits in linear time
+    BoundingBox3f b0;
+    int count0 = 0;
+    for (int i = 0; i < nBuckets - 1; ++i) {
+      b0.expandBy(axisBuckets[i].bounds);
+      count0 += axisBuckets[i].count;
+      cost[i] = count0 > 0 ? nbPacks(count0) * surfaceArea(b0) : 0.f;
+    }
+    BoundingBox3f b1;
+    int count1 = 0;
+    for (int i = nBuckets - 1; i > 0; --i) {
+      b1.expandBy(axisBuckets[i].bounds);
+      count1 += axisBuckets[i].count;
+      if (count1 > 0)
+        cost[i - 1] += nbPacks(count1) * surfaceArea(b1);
+    }
+
+    // Find bucket to split at that minimizes SAH metric
+    for (int i = 0; i < nBuckets - 1; ++i) {
+      float c = m_params.traversalCost * mainSA + cost[i];
+      if (c < minCost) {
+        minCost = c;
+        minCostDim = dim;
+        minCostSplit = i;
+      }
+    }
+  }
+
+  if (minCostDim < 0 ||
+      (minCost >= leafCost && count <= m_params.targetCellSize))
+    return false;
+
+  // Partition with the very same bucket computation as the binning
+  float minC = centroidBox.min[minCostDim];
+  float axisScale = scale[minCostDim];
+  mid_id = std::partition(m_faces.begin() + start, m_faces.begin() + end,
+                          [&](int f) {
+                            int b = std::min(
+                                nBuckets - 1,
+                                int((m_centroids[f][minCostDim] - minC) *
+                                    axisScale));
+                            return b <= minCostSplit;
+                          }) -
+           m_faces.begin();
+  axis = minCostDim;
+  return true;
+}
+
+void BVH::buildNode(NodeList &tree, int nodeId, int start, int end,
+                    int level) {
+  Node &node = tree[nodeId];
+
+  // compute bounding box
+  BoundingBox3f aabb = computeBounds(start, end);
   node.box = aabb;
 
   // stopping criteria
-  if (end - start <= targetCellSize || level >= maxDepth) {
+  if (end - start <= 1 ||
+      (m_params.splitMethod != SPLIT_SAH &&
+       end - start <= m_params.targetCellSize) ||
+      level >= m_params.maxDepth) {
     // we got a leaf !
     node.is_leaf = true;
     node.first_face_id = start;
     node.nb_faces = end - start;
-    assert(node.nb_faces < m_faces.size());
     return;
   }
   node.is_leaf = false;
@@ -132,89 +745,689 @@ void BVH::buildNode(int nodeId, int start, int end, int level,
   int dim;
   diag.maxCoeff(&dim);
 
-  float split_value;
-
-  if (m_splitMethod == SPLIT_EQUAL_COUNTS) {
-    /// TODO: Split at the mediane
-    split_value = 0.5 * (aabb.max[dim] + aabb.min[dim]);
-  } else if (m_splitMethod == SPLIT_SAH) {
-    // Split using SAH
-    // Init buckets
-    for (int i = 0; i < nBuckets; ++i) {
-      m_buckets[i].count = 0;
-      m_buckets[i].bounds.reset();
-    }
-    for (int i = start; i < end; ++i) {
-      int b = nBuckets * ((m_centroids[i](dim) - aabb.min(dim)) / diag(dim));
-      if (b == nBuckets)
-        b = nBuckets - 1;
-      m_buckets[b].count++;
-      m_buckets[b].bounds.expandBy(
-          m_pMesh->vertexOfFace(m_faces[i], 0).position);
-      m_buckets[b].bounds.expandBy(
-          m_pMesh->vertexOfFace(m_faces[i], 1).position);
-      m_buckets[b].bounds.expandBy(
-          m_pMesh->vertexOfFace(m_faces[i], 2).position);
-    }
-
-    // Compute cost per bucket
-    float cost[nBuckets - 1];
-    float mainSA = surfaceArea(aabb);
-    for (int i = 0; i < nBuckets - 1; ++i) {
-      BoundingBox3f b0, b1;
-      b0.reset();
-      b1.reset();
-      int count0 = 0, count1 = 0;
-      for (int j = 0; j <= i; ++j) {
-        b0.expandBy(m_buckets[j].bounds);
-        count0 += m_buckets[j].count;
+  int mid_id;
+  if (m_params.splitMethod == SPLIT_SAH) {
+    if (!splitSAH(start, end, aabb, mid_id, dim)) {
+      if (end - start <= m_params.targetCellSize) {
+        // a leaf is cheaper than any split
+        node.is_leaf = true;
+        node.first_face_id = start;
+        node.nb_faces = end - start;
+        return;
       }
-      for (int j = i + 1; j < nBuckets; ++j) {
-        b1.expandBy(m_buckets[j].bounds);
-        count1 += m_buckets[j].count;
-      }
-      cost[i] = .125f;
-      if (count0 > 0)
-        cost[i] += count0 * surfaceArea(b0) / mainSA;
-      if (count1 > 0)
-        cost[i] += count1 * surfaceArea(b1) / mainSA;
+      // all centroids are identical, handled below
+      mid_id = start;
     }
-    // Find bucket to split at that minimizes SAH metric
-    float minCost = cost[0];
-    int minCostSplit = 0;
-    for (int i = 1; i < nBuckets - 1; ++i) {
-      if (cost[i] < minCost) {
-        minCost = cost[i];
-        minCostSplit = i;
-      }
-    }
-    split_value = aabb.min[dim] + (minCostSplit + 1) * diag(dim) / nBuckets;
-    // m_buckets[minCostSplit].bounds.max[dim];
-    // 0.5 * (m_buckets[minCostSplit].bounds.max[dim] +
-    // m_buckets[minCostSplit].bounds.min[dim]);
+  } else if (m_params.splitMethod == SPLIT_EQUAL_COUNTS) {
+    // Split at the mediane
+    mid_id = (start + end) / 2;
+    std::nth_element(m_faces.begin() + start, m_faces.begin() + mid_id,
+                     m_faces.begin() + end, [&](int f0, int f1) {
+                       return m_centroids[f0][dim] < m_centroids[f1][dim];
+                     });
   } else {
     // Split at the middle
-    split_value = 0.5 * (aabb.max[dim] + aabb.min[dim]);
+    float split_value = 0.5 * (aabb.max[dim] + aabb.min[dim]);
+    // Sort the faces according to the split plane
+    mid_id = split(start, end, dim, split_value);
   }
 
-  // Sort the faces according to the split plane
-  int mid_id = split(start, end, dim, split_value);
-
   // second stopping criteria
   if (mid_id == start || mid_id >= end) {
-    // no improvement
+    if (end - start <= std::numeric_limits<unsigned short>::max()) {
+      // no improvement
+      node.is_leaf = true;
+      node.first_face_id = start;
+      node.nb_faces = end - start;
+      return;
+    }
+    // all centroids are identical: split arbitrarily to bound the leaf size
+    mid_id = (start + end) / 2;
+  }
+
+  node.axis = dim;
+
+  // create the children, the pool is never reallocated during the build
+  int child_id = m_nbNodes.fetch_add(2);
+  node.second_child_id = child_id + 1;
+
+  if (end - start >= ParallelSubtreeThreshold) {
+    tbb::parallel_invoke(
+        [&] { buildNode(tree, child_id, start, mid_id, level + 1); },
+        [&] { buildNode(tree, child_id + 1, mid_id, end, level + 1); });
+  } else {
+    buildNode(tree, child_id, start, mid_id, level + 1);
+    buildNode(tree, child_id + 1, mid_id, end, level + 1);
+  }
+}
+
+/// Spreads the MortonAxisBits low bits of \a x to every third bit
+static uint64_t expandMortonBits(uint64_t x) {
+  x &= (1ull << MortonAxisBits) - 1;
+  x = (x | x << 32) & 0x1f00000000ffffull;
+  x = (x | x << 16) & 0x1f0000ff0000ffull;
+  x = (x | x << 8) & 0x100f00f00f00f00full;
+  x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+  x = (x | x << 2) & 0x1249249249249249ull;
+  return x;
+}
+
+namespace {
+struct MortonPrimitive {
+  uint64_t code;
+  int index;
+};
+} // namespace
+
+/** Sorts \a items by increasing codes of \a nbBits bits, with a parallel
+ * least significant digit radix sort: each pass counts the digits of blocks
+ * of items in parallel, then scatters the blocks in parallel at the offsets
+ * given by the prefix sum of the counts, which keeps the sort stable. */
+static void radixSort(std::vector<MortonPrimitive> &items, int nbBits) {
+  const int DigitBits = 11, NbDigits = 1 << DigitBits;
+  const int n = items.size();
+  const int nbBlocks = (n + ParallelGrainSize - 1) / ParallelGrainSize;
+  std::vector<MortonPrimitive> buffer(n);
+  std::vector<int> offsets(nbBlocks * NbDigits);
+  for (int shift = 0; shift < nbBits; shift += DigitBits) {
+    auto digit = [&](const MortonPrimitive &item) {
+      return int(item.code >> shift) & (NbDigits - 1);
+    };
+    tbb::parallel_for(0, nbBlocks, [&](int block) {
+      int *count = &offsets[block * NbDigits];
+      std::fill(count, count + NbDigits, 0);
+      int end = std::min(n, (block + 1) * ParallelGrainSize);
+      for (int i = block * ParallelGrainSize; i < end; ++i)
+        count[digit(items[i])]++;
+    });
+    // offsets of the digits of each block: by digit, then by block
+    int sum = 0;
+    bool sorted = false;
+    for (int d = 0; d < NbDigits; ++d) {
+      int first = sum;
+      for (int block = 0; block < nbBlocks; ++block) {
+        int count = offsets[block * NbDigits + d];
+        offsets[block * NbDigits + d] = sum;
+        sum += count;
+      }
+      // all the items have the same digit: nothing to move
+      sorted |= sum - first == n;
+    }
+    if (sorted)
+      continue;
+    tbb::parallel_for(0, nbBlocks, [&](int block) {
+      int *offset = &offsets[block * NbDigits];
+      int end = std::min(n, (block + 1) * ParallelGrainSize);
+      for (int i = block * ParallelGrainSize; i < end; ++i)
+        buffer[offset[digit(items[i])]++] = items[i];
+    });
+    items.swap(buffer);
+  }
+}
+
+void BVH::buildMorton(NodeList &tree) {
+  int nbPrimitives = m_faces.size();
+  BoundingBox3f centroidBox = computeCentroidBounds(0, nbPrimitives);
+  Vector3f extents = centroidBox.getExtents();
+  const float maxCell = float(1 << MortonAxisBits);
+  Vector3f scale;
+  for (int dim = 0; dim < 3; ++dim)
+    scale[dim] = extents[dim] > 0.f ? maxCell / extents[dim] : 0.f;
+
+  std::vector<MortonPrimitive> primitives(nbPrimitives);
+  tbb::parallel_for(
+      tbb::blocked_range<int>(0, nbPrimitives, ParallelGrainSize),
+      [&](const tbb::blocked_range<int> &range) {
+        for (int i = range.begin(); i < range.end(); ++i) {
+          Vector3f cell = (m_centroids[i] - centroidBox.min)
+                              .cwiseProduct(scale)
+                              .cwiseMin(maxCell - 1.f);
+          primitives[i].code = expandMortonBits(uint64_t(cell.x())) << 2 |
+                               expandMortonBits(uint64_t(cell.y())) << 1 |
+                               expandMortonBits(uint64_t(cell.z()));
+          primitives[i].index = i;
+        }
+      });
+  radixSort(primitives, 3 * MortonAxisBits);
+  // the bounds are also sorted, so that the subtrees read them sequentially
+  m_mortonCodes.resize(nbPrimitives);
+  std::vector<BoundingBox3f> sortedBounds(nbPrimitives);
+  tbb::parallel_for(
+      tbb::blocked_range<int>(0, nbPrimitives, ParallelGrainSize),
+      [&](const tbb::blocked_range<int> &range) {
+        for (int i = range.begin(); i < range.end(); ++i) {
+          m_faces[i] = primitives[i].index;
+          m_mortonCodes[i] = primitives[i].code;
+          sortedBounds[i] = m_bounds[primitives[i].index];
+        }
+      });
+  std::vector<MortonPrimitive>().swap(primitives);
+  m_bounds.swap(sortedBounds);
+  std::vector<BoundingBox3f>().swap(sortedBounds);
+
+  if (m_params.splitMethod == SPLIT_LBVH) {
+    buildMortonNode(tree, 0, 0, nbPrimitives, 0);
+    return;
+  }
+
+  // clusters of the primitives sharing the first bits of their codes
+  const int shift = 3 * MortonAxisBits - HLBVHClusterBits;
+  std::vector<MortonCluster> clusters;
+  for (int i = 0; i < nbPrimitives; ++i) {
+    if (i == 0 ||
+        (m_mortonCodes[i] >> shift) != (m_mortonCodes[i - 1] >> shift)) {
+      clusters.emplace_back();
+      clusters.back().start = i;
+    }
+    clusters.back().end = i + 1;
+  }
+  tbb::parallel_for(0, int(clusters.size()), [&](int c) {
+    for (int i = clusters[c].start; i < clusters[c].end; ++i)
+      clusters[c].box.expandBy(m_bounds[i]);
+  });
+  buildClusterNode(tree, 0, clusters, 0, clusters.size(), 0);
+  tbb::parallel_for(0, int(clusters.size()), [&](int c) {
+    buildMortonNode(tree, clusters[c].nodeId, clusters[c].start,
+                    clusters[c].end, clusters[c].level);
+  });
+}
+
+BoundingBox3f BVH::buildMortonNode(NodeList &tree, int nodeId, int start,
+                                   int end, int level) {
+  Node &node = tree[nodeId];
+  if (end - start <= m_params.targetCellSize || level >= m_params.maxDepth) {
+    node.box.reset();
+    for (int i = start; i < end; ++i)
+      node.box.expandBy(m_bounds[i]);
     node.is_leaf = true;
     node.first_face_id = start;
     node.nb_faces = end - start;
-    assert(node.nb_faces < m_faces.size());
+    return node.box;
+  }
+  node.is_leaf = false;
+
+  // the codes of the range only differ below their highest differing bit
+  uint64_t differences = m_mortonCodes[start] ^ m_mortonCodes[end - 1];
+  int mid_id;
+  if (differences == 0) {
+    // identical codes: split arbitrarily to bound the leaf size
+    mid_id = (start + end) / 2;
+    node.axis = 0;
+  } else {
+    int bit = 63;
+    while (!(differences >> bit))
+      --bit;
+    mid_id = std::partition_point(m_mortonCodes.begin() + start,
+                                  m_mortonCodes.begin() + end,
+                                  [&](uint64_t code) {
+                                    return !((code >> bit) & 1);
+                                  }) -
+             m_mortonCodes.begin();
+    // the bits are interleaved as x, y, z from the highest one
+    node.axis = 2 - bit % 3;
+  }
+
+  int child_id = m_nbNodes.fetch_add(2);
+  node.second_child_id = child_id + 1;
+  BoundingBox3f left, right;
+  if (end - start >= ParallelSubtreeThreshold) {
+    tbb::parallel_invoke(
+        [&] {
+          left = buildMortonNode(tree, child_id, start, mid_id, level + 1);
+        },
+        [&] {
+          right = buildMortonNode(tree, child_id + 1, mid_id, end, level + 1);
+        });
+  } else {
+    left = buildMortonNode(tree, child_id, start, mid_id, level + 1);
+    right = buildMortonNode(tree, child_id + 1, mid_id, end, level + 1);
+  }
+  node.box = BoundingBox3f::merge(left, right);
+  return node.box;
+}
+
+void BVH::buildClusterNode(NodeList &tree, int nodeId,
+                           std::vector<MortonCluster> &clusters, int begin,
+                           int end, int level) {
+  if (end - begin == 1) {
+    // the subtree of the cluster is built afterwards, in parallel
+    clusters[begin].nodeId = nodeId;
+    clusters[begin].level = level;
+    return;
+  }
+  Node &node = tree[nodeId];
+  node.box.reset();
+  for (int c = begin; c < end; ++c)
+    node.box.expandBy(clusters[c].box);
+  node.is_leaf = false;
+
+  // full SAH sweep over the few clusters, sorted by centroid along each axis
+  const int align = m_params.leafAlignment;
+  auto nbPacks = [&](int n) { return float((n + align - 1) / align); };
+  auto byCentroid = [](int dim) {
+    return [dim](const MortonCluster &a, const MortonCluster &b) {
+      return a.box.min[dim] + a.box.max[dim] < b.box.min[dim] + b.box.max[dim];
+    };
+  };
+  float minCost = std::numeric_limits<float>::infinity();
+  int minCostDim = 0, minCostSplit = begin + 1;
+  std::vector<float> cost(end - begin);
+  for (int dim = 0; dim < 3; ++dim) {
+    std::sort(clusters.begin() + begin, clusters.begin() + end,
+              byCentroid(dim));
+    BoundingBox3f b0;
+    int count0 = 0;
+    for (int c = begin; c < end - 1; ++c) {
+      b0.expandBy(clusters[c].box);
+      count0 += clusters[c].end - clusters[c].start;
+      cost[c - begin] = nbPacks(count0) * surfaceArea(b0);
+    }
+    BoundingBox3f b1;
+    int count1 = 0;
+    for (int c = end - 1; c > begin; --c) {
+      b1.expandBy(clusters[c].box);
+      count1 += clusters[c].end - clusters[c].start;
+      float c1 = cost[c - 1 - begin] + nbPacks(count1) * surfaceArea(b1);
+      if (c1 < minCost) {
+        minCost = c1;
+        minCostDim = dim;
+        minCostSplit = c;
+      }
+    }
+  }
+  if (minCostDim != 2)
+    std::sort(clusters.begin() + begin, clusters.begin() + end,
+              byCentroid(minCostDim));
+  node.axis = minCostDim;
+
+  int child_id = m_nbNodes.fetch_add(2);
+  node.second_child_id = child_id + 1;
+  buildClusterNode(tree, child_id, clusters, begin, minCostSplit, level + 1);
+  buildClusterNode(tree, child_id + 1, clusters, minCostSplit, end,
+                   level + 1);
+}
+
+void BVH::findObjectSplit(const ReferenceList &refs, const BoundingBox3f &box,
+                          SplitCandidate &split) const {
+  const int nBuckets = m_params.nbBins;
+  const int count = refs.size();
+  BoundingBox3f centroidBox;
+  for (const Reference &ref : refs)
+    centroidBox.expandBy(ref.box.getCenter());
+
+  const int align = m_params.leafAlignment;
+  auto nbPacks = [&](int n) { return float((n + align - 1) / align); };
+  float mainSA = surfaceArea(box);
+  std::vector<BucketInfo> buckets(nBuckets);
+  std::vector<BoundingBox3f> rightBounds(nBuckets);
+  for (int dim = 0; dim < 3; ++dim) {
+    float extent = centroidBox.max[dim] - centroidBox.min[dim];
+    if (!(extent > 0.f))
+      continue;
+    float origin = centroidBox.min[dim];
+    float scale = nBuckets / extent;
+    std::fill(buckets.begin(), buckets.end(), BucketInfo());
+    for (const Reference &ref : refs) {
+      int b = std::min(nBuckets - 1,
+                       int((ref.box.getCenter()[dim] - origin) * scale));
+      buckets[b].count++;
+      buckets[b].bounds.expandBy(ref.box);
+    }
+
+    // sweep from the right to get the bounds of the right children, then
+    // from the left to evaluate the splits
+    BoundingBox3f b1;
+    for (int i = nBuckets - 1; i > 0; --i) {
+      b1.expandBy(buckets[i].bounds);
+      rightBounds[i - 1] = b1;
+    }
+    BoundingBox3f b0;
+    int count0 = 0;
+    for (int i = 0; i < nBuckets - 1; ++i) {
+      b0.expandBy(buckets[i].bounds);
+      count0 += buckets[i].count;
+      int count1 = count - count0;
+      if (count0 == 0 || count1 == 0)
+        continue;
+      float cost = m_params.traversalCost * mainSA +
+                   nbPacks(count0) * surfaceArea(b0) +
+                   nbPacks(count1) * surfaceArea(rightBounds[i]);
+      if (cost < split.cost) {
+        split.cost = cost;
+        split.axis = dim;
+        split.origin = origin;
+        split.scale = scale;
+        split.bin = i;
+        split.left = b0;
+        split.right = rightBounds[i];
+        split.nbLeft = count0;
+        split.nbRight = count1;
+      }
+    }
+  }
+}
+
+void BVH::findSpatialSplit(const ReferenceList &refs, const BoundingBox3f &box,
+                           SplitCandidate &split) const {
+  const int nBins = m_params.nbBins;
+  const int count = refs.size();
+  const int budget = m_splitBudget;
+
+  const int align = m_params.leafAlignment;
+  auto nbPacks = [&](int n) { return float((n + align - 1) / align); };
+  float mainSA = surfaceArea(box);
+  std::vector<BoundingBox3f> bins(nBins), rightBounds(nBins);
+  // number of references starting and ending in each bin
+  std::vector<int> entries(nBins), exits(nBins);
+  for (int dim = 0; dim < 3; ++dim) {
+    float extent = box.max[dim] - box.min[dim];
+    if (!(extent > 0.f))
+      continue;
+    float origin = box.min[dim];
+    float scale = nBins / extent;
+    auto binOf = [&](float x) {
+      return clamp(int((x - origin) * scale), 0, nBins - 1);
+    };
+    std::fill(bins.begin(), bins.end(), BoundingBox3f());
+    std::fill(entries.begin(), entries.end(), 0);
+    std::fill(exits.begin(), exits.end(), 0);
+    for (const Reference &ref : refs) {
+      int first = binOf(ref.box.min[dim]);
+      int last = binOf(ref.box.max[dim]);
+      entries[first]++;
+      exits[last]++;
+      // clip the reference by the planes between its bins
+      BoundingBox3f part = ref.box;
+      for (int b = first; b < last && part.isValid(); ++b) {
+        BoundingBox3f left, right;
+        m_splitPrimitive(ref.prim, part, dim, origin + (b + 1) / scale, left,
+                         right);
+        bins[b].expandBy(left);
+        part = right;
+      }
+      bins[last].expandBy(part);
+    }
+
+    BoundingBox3f b1;
+    for (int i = nBins - 1; i > 0; --i) {
+      b1.expandBy(bins[i]);
+      rightBounds[i - 1] = b1;
+    }
+    BoundingBox3f b0;
+    int count0 = 0, count1 = count;
+    for (int i = 0; i < nBins - 1; ++i) {
+      b0.expandBy(bins[i]);
+      count0 += entries[i];
+      count1 -= exits[i];
+      if (count0 == 0 || count1 == 0 || count0 + count1 - count > budget ||
+          !b0.isValid() || !rightBounds[i].isValid())
+        continue;
+      float cost = m_params.traversalCost * mainSA +
+                   nbPacks(count0) * surfaceArea(b0) +
+                   nbPacks(count1) * surfaceArea(rightBounds[i]);
+      if (cost < split.cost) {
+        split.cost = cost;
+        split.axis = dim;
+        split.origin = origin;
+        split.scale = scale;
+        split.bin = i;
+        split.left = b0;
+        split.right = rightBounds[i];
+        split.nbLeft = count0;
+        split.nbRight = count1;
+      }
+    }
+  }
+}
+
+void BVH::buildSpatialNode(NodeList &tree, int nodeId, ReferenceList &refs,
+                           int level) {
+  Node &node = tree[nodeId];
+  const int count = refs.size();
+  BoundingBox3f aabb;
+  for (const Reference &ref : refs)
+    aabb.expandBy(ref.box);
+  node.box = aabb;
+
+  auto makeLeaf = [&]() {
+    int first = m_nbReferences.fetch_add(count);
+    for (int i = 0; i < count; ++i)
+      m_faces[first + i] = refs[i].prim;
+    node.is_leaf = true;
+    node.first_face_id = first;
+    node.nb_faces = count;
+    ReferenceList().swap(refs);
+  };
+
+  if (count <= 1 || level >= m_params.maxDepth) {
+    makeLeaf();
+    return;
+  }
+
+  const int align = m_params.leafAlignment;
+  auto nbPacks = [&](int n) { return float((n + align - 1) / align); };
+  float leafCost = nbPacks(count) * surfaceArea(aabb);
+
+  SplitCandidate objectSplit;
+  findObjectSplit(refs, aabb, objectSplit);
+  // the spatial splits only pay off where the children overlap
+  SplitCandidate spatialSplit;
+  BoundingBox3f overlap = objectSplit.left;
+  overlap.clip(objectSplit.right);
+  if (m_splitBudget > 0 &&
+      (objectSplit.axis < 0 ||
+       (overlap.isValid() &&
+        surfaceArea(overlap) > SpatialSplitAlpha * m_rootArea)))
+    findSpatialSplit(refs, aabb, spatialSplit);
+
+  if (std::min(objectSplit.cost, spatialSplit.cost) >= leafCost &&
+      count <= m_params.targetCellSize) {
+    // a leaf is cheaper than any split
+    makeLeaf();
     return;
   }
 
-  // create the children
-  int child_id = node.first_child_id = m_nodes.size();
-  m_nodes.resize(m_nodes.size() + 2);
-  // node is not a valid reference anymore !
+  ReferenceList left, right;
+  int dim = -1;
+  if (spatialSplit.cost < objectSplit.cost) {
+    // reserve the duplicated references in the budget shared by the tasks
+    int reserved = spatialSplit.nbLeft + spatialSplit.nbRight - count;
+    if (m_splitBudget.fetch_sub(reserved) >= reserved) {
+      dim = spatialSplit.axis;
+      float position =
+          spatialSplit.origin + (spatialSplit.bin + 1) / spatialSplit.scale;
+      BoundingBox3f &leftBox = spatialSplit.left;
+      BoundingBox3f &rightBox = spatialSplit.right;
+      int nbLeft = spatialSplit.nbLeft, nbRight = spatialSplit.nbRight;
+      int duplicated = 0;
+      for (const Reference &ref : refs) {
+        if (ref.box.max[dim] <= position) {
+          left.push_back(ref);
+          continue;
+        }
+        if (ref.box.min[dim] >= position) {
+          right.push_back(ref);
+          continue;
+        }
+        Reference l = ref, r = ref;
+        m_splitPrimitive(ref.prim, ref.box, dim, position, l.box, r.box);
+        if (!l.box.isValid() || !r.box.isValid()) {
+          (l.box.isValid() ? left : right).push_back(ref);
+          continue;
+        }
+        // keeping the whole reference on one side may be cheaper than
+        // duplicating it (reference unsplitting)
+        float splitCost = nbPacks(nbLeft) * surfaceArea(leftBox) +
+                          nbPacks(nbRight) * surfaceArea(rightBox);
+        float leftCost = nbRight > 1
+                             ? nbPacks(nbLeft) *
+                                       surfaceArea(BoundingBox3f::merge(
+                                           leftBox, ref.box)) +
+                                   nbPacks(nbRight - 1) * surfaceArea(rightBox)
+                             : std::numeric_limits<float>::infinity();
+        float rightCost = nbLeft > 1
+                              ? nbPacks(nbLeft - 1) * surfaceArea(leftBox) +
+                                    nbPacks(nbRight) *
+                                        surfaceArea(BoundingBox3f::merge(
+                                            rightBox, ref.box))
+                              : std::numeric_limits<float>::infinity();
+        if (duplicated < reserved && splitCost <= leftCost &&
+            splitCost <= rightCost) {
+          left.push_back(l);
+          right.push_back(r);
+          duplicated++;
+        } else if (leftCost <= rightCost) {
+          left.push_back(ref);
+          leftBox.expandBy(ref.box);
+          nbRight--;
+        } else {
+          right.push_back(ref);
+          rightBox.expandBy(ref.box);
+          nbLeft--;
+        }
+      }
+      m_splitBudget += reserved - duplicated;
+      if (left.empty() || right.empty()) {
+        // the references could not be separated, e.g. because of rounding
+        m_splitBudget += duplicated;
+        left.clear();
+        right.clear();
+        dim = -1;
+      }
+    } else {
+      m_splitBudget += reserved;
+    }
+  }
+  if (dim < 0 && objectSplit.axis >= 0) {
+    dim = objectSplit.axis;
+    for (const Reference &ref : refs) {
+      int b = std::min(m_params.nbBins - 1,
+                       int((ref.box.getCenter()[dim] - objectSplit.origin) *
+                           objectSplit.scale));
+      (b <= objectSplit.bin ? left : right).push_back(ref);
+    }
+  }
+  if (dim < 0) {
+    if (count <= std::numeric_limits<unsigned short>::max()) {
+      // no improvement
+      makeLeaf();
+      return;
+    }
+    // all centroids are identical: split arbitrarily to bound the leaf size
+    Vector3f diag = aabb.getExtents();
+    diag.maxCoeff(&dim);
+    left.assign(refs.begin(), refs.begin() + count / 2);
+    right.assign(refs.begin() + count / 2, refs.end());
+  }
+  ReferenceList().swap(refs);
+  node.is_leaf = false;
+  node.axis = dim;
+
+  // create the children, the pool is never reallocated during the build
+  int child_id = m_nbNodes.fetch_add(2);
+  node.second_child_id = child_id + 1;
+
+  if (count >= ParallelSubtreeThreshold) {
+    tbb::parallel_invoke(
+        [&] { buildSpatialNode(tree, child_id, left, level + 1); },
+        [&] { buildSpatialNode(tree, child_id + 1, right, level + 1); });
+  } else {
+    buildSpatialNode(tree, child_id, left, level + 1);
+    buildSpatialNode(tree, child_id + 1, right, level + 1);
+  }
+}
 
-  buildNode(child_id, start, mid_id, level + 1, targetCellSize, maxDepth);
-  buildNode(child_id + 1, mid_id, end, level + 1, targetCellSize, maxDepth);
+/// Writes the raw bytes of \a value
+template <typename T> static void writeRaw(std::ostream &os, const T &value) {
+  os.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+/// Writes the size and the raw content of \a array
+template <typename Array>
+static void writeArray(std::ostream &os, const Array &array) {
+  writeRaw(os, uint64_t(array.size()));
+  os.write(reinterpret_cast<const char *>(array.data()),
+           array.size() * sizeof(typename Array::value_type));
+}
+
+/// Sequential reader of the data written by BVH::save()
+struct BVHFileReader {
+  const char *data;
+  size_t size, pos;
+
+  template <typename T> bool readRaw(T &value) {
+    if (size - pos < sizeof(T))
+      return false;
+    std::memcpy(reinterpret_cast<char *>(&value), data + pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+  }
+
+  template <typename Array> bool readArray(Array &array) {
+    uint64_t count;
+    if (!readRaw(count) ||
+        (size - pos) / sizeof(typename Array::value_type) < count)
+      return false;
+    array.resize(count);
+    std::memcpy(reinterpret_cast<char *>(array.data()), data + pos,
+                count * sizeof(typename Array::value_type));
+    pos += count * sizeof(typename Array::value_type);
+    return true;
+  }
+};
+
+std::vector<uint32_t> BVH::fileSignature() {
+  return {0x48564253u /* magic */,
+          1 /* version */,
+          sizeof(BuildParams),
+          sizeof(BoundingBox3f),
+          sizeof(Node),
+          sizeof(WideNode<4>),
+          sizeof(WideNode<8>),
+          sizeof(QuantizedNode<4, uint8_t>),
+          sizeof(QuantizedNode<8, uint16_t>)};
+}
+
+void BVH::save(std::ostream &os) const {
+  writeArray(os, fileSignature());
+  writeRaw(os, m_params);
+  writeRaw(os, m_nbPrimitives);
+  writeRaw(os, m_nbSplitReferences);
+  writeRaw(os, m_buildSahCost);
+  writeRaw(os, m_bbox);
+  writeArray(os, m_faces);
+  writeArray(os, m_nodes);
+  writeArray(os, m_nodes4);
+  writeArray(os, m_nodes8);
+  writeArray(os, m_nodes4q8);
+  writeArray(os, m_nodes4q16);
+  writeArray(os, m_nodes8q8);
+  writeArray(os, m_nodes8q16);
+}
+
+bool BVH::load(const char *data, size_t size) {
+  BVHFileReader reader = {data, size, 0};
+  std::vector<uint32_t> signature;
+  if (!reader.readArray(signature) || signature != fileSignature())
+    return false;
+  bool valid = reader.readRaw(m_params) && reader.readRaw(m_nbPrimitives) &&
+               reader.readRaw(m_nbSplitReferences) &&
+               reader.readRaw(m_buildSahCost) && reader.readRaw(m_bbox) &&
+               reader.readArray(m_faces) && reader.readArray(m_nodes) &&
+               reader.readArray(m_nodes4) && reader.readArray(m_nodes8) &&
+               reader.readArray(m_nodes4q8) && reader.readArray(m_nodes4q16) &&
+               reader.readArray(m_nodes8q8) && reader.readArray(m_nodes8q16);
+  if (!valid) {
+    // leave an empty hierarchy rather than a partial one
+    m_nbPrimitives = 0;
+    m_faces.clear();
+    m_nodes.clear();
+    m_nodes4.clear();
+    m_nodes8.clear();
+    m_nodes4q8.clear();
+    m_nodes4q16.clear();
+    m_nodes8q8.clear();
+    m_nodes8q16.clear();
+  }
+  return valid;
 }
@@ -1,60 +1,847 @@
-
 #ifndef BVH_H
 #define BVH_H
 
 #include <Eigen/Geometry>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
 #include <vector>
 #include "ray.h"
+#include "stats.h"
 #include "accelerators/bbox.h"
+#include "accelerators/frustum.h"
 
-class Mesh;
-
+/** \class BVH
+ * Bounding Volume Hierarchy over a set of primitives given by their
+ * axis-aligned bounding boxes.
+ *
+ * The hierarchy does not know what the primitives are: it is used both by
+ * the Mesh (one primitive per triangle) and by the Scene (one primitive per
+ * shape). The actual ray/primitive test is provided at traversal time by the
+ * caller as a function object taking the primitive index.
+ *
+ * The construction is parallelized with TBB: the bounds and the SAH bins of
+ * the large nodes are computed in parallel, and the subtrees are built as
+ * independent tasks writing into a preallocated pool of nodes.
+ *
+ * With SPLIT_SBVH, the nodes may also be split by a plane cutting through
+ * the primitives (Stich et al., "Spatial Splits in Bounding Volume
+ * Hierarchies", 2009): a primitive is then referenced by several leaves,
+ * which reduces the overlap of the children for long and thin primitives.
+ *
+ * SPLIT_LBVH is a linear build for very large inputs (Lauterbach et al.,
+ * "Fast BVH Construction on GPUs", 2009): the primitives are sorted along
+ * the Morton curve of their centroids with a parallel radix sort, and each
+ * node is split where the highest bit of the Morton codes of its primitives
+ * changes. SPLIT_HLBVH builds the top levels of this hierarchy, over the
+ * clusters of primitives sharing the first bits of their codes, with the SAH
+ * (Pantaleoni and Luebke, "HLBVH", 2010), for a better quality at little
+ * cost.
+ */
 class BVH
 {
-  
+
+  /** Nodes are stored in depth-first order: the first child of an inner node
+   * immediately follows it, only the index of the second child is stored. */
   struct Node {
     BoundingBox3f box;
     union {
-      int first_child_id; // for inner nodes
-      int first_face_id;  // for leaves
+      int second_child_id; // for inner nodes
+      int first_face_id;   // for leaves
     };
     unsigned short nb_faces;
-    short is_leaf = false;
+    unsigned char axis; // split axis of inner nodes
+    unsigned char is_leaf = false;
+  };
+
+  /** Node of a 4-wide or 8-wide hierarchy, collapsed from the binary one. The
+   * boxes of the children are stored in SoA layout so that they are all
+   * tested at once with SIMD instructions. */
+  template <int N> struct WideNode {
+    static constexpr int Width = N;
+    typedef Eigen::Array<float, N, 1> Lanes;
+    Lanes boxMin[3], boxMax[3];
+    /// Index of the child node, or of the first face of a leaf child
+    int child[N];
+    /// Number of faces of a leaf child, 0 for inner nodes, -1 if empty
+    int nb_faces[N];
+
+    /// Bounds of the children along the axis \a dim
+    void childBounds(int dim, Lanes &lower, Lanes &upper) const {
+      lower = boxMin[dim];
+      upper = boxMax[dim];
+    }
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
   };
 
+  /** Compressed version of WideNode: the bounds of the children are stored
+   * on 8 or 16 bits integers (\a Q) relative to the bounds of the node,
+   * rounded outwards so that the decoded boxes contain the exact ones. */
+  template <int N, typename Q> struct QuantizedNode {
+    static constexpr int Width = N;
+    typedef Eigen::Array<float, N, 1> Lanes;
+    /// The bounds are decoded as origin + q * scale
+    float origin[3], scale[3];
+    Q boxMin[3][N], boxMax[3][N];
+    int child[N];
+    int nb_faces[N];
+
+    void childBounds(int dim, Lanes &lower, Lanes &upper) const {
+      // widened to int first: Eigen only vectorizes the int to float cast
+      Eigen::Array<int, N, 1> qMin, qMax;
+      for (int i = 0; i < N; ++i) {
+        qMin[i] = boxMin[dim][i];
+        qMax[i] = boxMax[dim][i];
+      }
+      lower = origin[dim] + qMin.template cast<float>() * scale[dim];
+      upper = origin[dim] + qMax.template cast<float>() * scale[dim];
+    }
+  };
+
+  template <int N>
+  using WideNodeList =
+      std::vector<WideNode<N>, Eigen::aligned_allocator<WideNode<N>>>;
+  template <int N, typename Q>
+  using QuantizedNodeList = std::vector<QuantizedNode<N, Q>>;
+
   struct BucketInfo {
       BucketInfo() { count = 0; }
       int count;
       BoundingBox3f bounds;
   };
-  
+
   typedef std::vector<Node> NodeList;
 
-  enum SplitMethod { SPLIT_MIDDLE, SPLIT_EQUAL_COUNTS, SPLIT_SAH };
+  /// Part of a primitive referenced by a node of a spatial split hierarchy
+  struct Reference {
+    BoundingBox3f box;
+    int prim;
+  };
+
+  typedef std::vector<Reference> ReferenceList;
+
+  /// Best split of the references of a node along one of the axes
+  struct SplitCandidate {
+    float cost = std::numeric_limits<float>::infinity();
+    int axis = -1;
+    /// The bins are computed as (x - origin) * scale, the left child gets
+    /// the bins [0, bin]
+    float origin = 0.f, scale = 0.f;
+    int bin = 0;
+    /// Bounds and number of references of the children
+    BoundingBox3f left, right;
+    int nbLeft = 0, nbRight = 0;
+  };
+
+  /** Primitives [start, end) of m_faces sharing the first bits of their
+   * Morton codes, built as one subtree by SPLIT_HLBVH */
+  struct MortonCluster {
+    int start, end;
+    BoundingBox3f box;
+    /// Node of the subtree and its depth, assigned by buildClusterNode()
+    int nodeId = 0, level = 0;
+  };
 
-  static const int nBuckets = 12;
-  
 public:
-  
-  void build(const Mesh* pMesh, int targetCellSize, int maxDepth);
-  bool intersect(const Ray& ray, Hit& hit) const;
-   
+
+  enum SplitMethod {
+    SPLIT_MIDDLE,
+    SPLIT_EQUAL_COUNTS,
+    SPLIT_SAH,
+    SPLIT_SBVH,
+    SPLIT_LBVH,
+    SPLIT_HLBVH
+  };
+
+  /// Parameters of the construction of the hierarchy
+  struct BuildParams {
+    SplitMethod splitMethod = SPLIT_SAH;
+    /// Maximal number of primitives in a leaf
+    int targetCellSize = 10;
+    /// Maximal depth, bounded by the size of the traversal stack
+    int maxDepth = 64;
+    /// Number of bins along each axis for the SAH
+    int nbBins = 12;
+    /// Cost of traversing a node relative to a primitive intersection
+    float traversalCost = .125f;
+    /// Number of children per node: 2 (binary), 4 or 8
+    int width = 2;
+    /** The leaves start at multiples of this number of positions in the leaf
+     * order, and are padded with copies of their last primitive, so that
+     * the callers can store their primitives in aligned SIMD packs */
+    int leafAlignment = 1;
+    /** Number of bits (8 or 16) of the quantized bounds of the wide nodes,
+     * 0 to store them as floats */
+    int quantization = 0;
+    /** Maximal number of references added by the spatial splits of
+     * SPLIT_SBVH, relative to the number of primitives */
+    float splitBudget = .3f;
+    /** update() rebuilds the hierarchy when refitting it increases its SAH
+     * cost by more than this factor */
+    float rebuildThreshold = 1.5f;
+  };
+
+  /** Clips the part of the primitive \a prim contained in \a box by the plane
+   * of coordinate \a position along the axis \a dim. \a left and \a right
+   * receive the bounds of the parts on each side of the plane. */
+  typedef std::function<void(int prim, const BoundingBox3f &box, int dim,
+                             float position, BoundingBox3f &left,
+                             BoundingBox3f &right)>
+      PrimitiveSplitter;
+
+  /// Parses a split method name ("middle", "equal", "sah" or "sbvh")
+  static SplitMethod splitMethodFromString(const std::string &name);
+  static std::string splitMethodName(SplitMethod method);
+
+  /** Builds the hierarchy over the primitives whose bounding boxes are given
+   * in \a bounds. The i-th box corresponds to the primitive index i.
+   * \a splitPrimitive is required by SPLIT_SBVH only. */
+  void build(const std::vector<BoundingBox3f> &bounds,
+             const BuildParams &params,
+             const PrimitiveSplitter &splitPrimitive = PrimitiveSplitter());
+
+  /** Updates the bounds of the nodes bottom-up, in parallel, after the
+   * primitives moved to the new \a bounds (indexed as in build()). The
+   * topology of the hierarchy is kept. \returns the SAH cost of the refitted
+   * hierarchy relative to its cost after the construction. */
+  float refit(const std::vector<BoundingBox3f> &bounds);
+
+  /** Refits the hierarchy, or rebuilds it with the construction parameters
+   * if its SAH cost degrades by more than BuildParams::rebuildThreshold.
+   * \returns true if it was rebuilt, and the measured degradation in
+   * \a degradation. */
+  bool update(const std::vector<BoundingBox3f> &bounds, float &degradation,
+              const PrimitiveSplitter &splitPrimitive = PrimitiveSplitter());
+
+  /** \returns the SAH cost of the hierarchy (relative to the cost of a
+   * primitive test), normalized by the area of the root */
+  float sahCost() const;
+
+  /** Search the nearest intersection between the ray and the primitives.
+   * \a intersectPrimitive(i) is called for each primitive of the visited
+   * leaves, where \a i is the position of the primitive in the leaf order
+   * (see primitiveId()), so that the callers can store their primitive data
+   * in that order. It must return true and shorten \a hit.t when it finds a
+   * closer intersection. */
+  template <typename PrimitiveIntersector>
+  bool intersect(const Ray &ray, Hit &hit,
+                 const PrimitiveIntersector &intersectPrimitive) const {
+    return intersectLeaves(ray, hit, [&](int first, int count) {
+      bool found = false;
+      for (int i = first; i < first + count; ++i)
+        found = intersectPrimitive(i) | found;
+      return found;
+    });
+  }
+
+  /** Same as intersect(), but \a intersectLeaf(first, count) is called once
+   * for each visited leaf, which covers the positions [first, first+count)
+   * in the leaf order (\a first is a multiple of the leaf alignment). */
+  template <typename LeafIntersector>
+  bool intersectLeaves(const Ray &ray, Hit &hit,
+                       const LeafIntersector &intersectLeaf) const {
+    return traverse<false>(ray, hit, intersectLeaf);
+  }
+
+  /** \returns true if any primitive is hit before \a tMax, stopping at the
+   * first one found. \a occludedByPrimitive(i) must return true if the
+   * primitive at position \a i in the leaf order is hit before \a tMax. */
+  template <typename PrimitiveIntersector>
+  bool occluded(const Ray &ray, float tMax,
+                const PrimitiveIntersector &occludedByPrimitive) const {
+    return occludedLeaves(ray, tMax, [&](int first, int count) {
+      for (int i = first; i < first + count; ++i) {
+        if (occludedByPrimitive(i))
+          return true;
+      }
+      return false;
+    });
+  }
+
+  /// Same as occluded(), with a callback per leaf as in intersectLeaves()
+  template <typename LeafIntersector>
+  bool occludedLeaves(const Ray &ray, float tMax,
+                      const LeafIntersector &occludedByLeaf) const {
+    Hit hit;
+    hit.t = tMax;
+    return traverse<true>(ray, hit, occludedByLeaf);
+  }
+
+  /** Packet version of intersect(), for the rays of \a packet selected by
+   * \a mask, whose nearest hits are in \a hits (one per lane).
+   * \a intersectPrimitive(i, laneMask) is called for each primitive of the
+   * visited leaves with the rays which hit the leaf before their current
+   * nearest hit, and must shorten the \a hits of these rays. */
+  template <typename PrimitiveIntersector>
+  void intersectPacket(const RayPacket &packet, uint32_t mask, Hit *hits,
+                       const PrimitiveIntersector &intersectPrimitive) const {
+    intersectPacketLeaves(packet, mask, hits,
+                          [&](int first, int count, uint32_t laneMask) {
+                            for (int i = first; i < first + count; ++i)
+                              intersectPrimitive(i, laneMask);
+                          });
+  }
+
+  /** Same as intersectPacket(), but \a intersectLeaf(first, count, laneMask)
+   * is called once for each visited leaf. The binary hierarchy is traversed
+   * by the whole packet, with an active mask per node; the wide ones are
+   * traversed ray by ray. */
+  template <typename LeafIntersector>
+  void intersectPacketLeaves(const RayPacket &packet, uint32_t mask,
+                             Hit *hits,
+                             const LeafIntersector &intersectLeaf) const {
+    if (m_params.width == 2) {
+      switch (packet.size) {
+      case 4:
+        return intersectPacketBinary<4>(packet, mask, hits, intersectLeaf);
+      case 8:
+        return intersectPacketBinary<8>(packet, mask, hits, intersectLeaf);
+      case 16:
+        return intersectPacketBinary<16>(packet, mask, hits, intersectLeaf);
+      }
+    }
+    for (int lane = 0; lane < packet.size; ++lane) {
+      if (!((mask >> lane) & 1))
+        continue;
+      intersectLeaves(packet.rays[lane], hits[lane],
+                      [&](int first, int count) {
+                        intersectLeaf(first, count, 1u << lane);
+                        return false;
+                      });
+    }
+  }
+
+  /** Stream version of occludedLeaves(), for a large batch of incoherent
+   * rays (e.g. the shadow rays of many pixels): the rays rays[ids[k]],
+   * k < \a count, are filtered at each node of the binary hierarchy, the
+   * rays hitting its box being passed to its children, so that each node is
+   * loaded once per stream rather than once per ray. The rays are clipped
+   * to their own \a tMax. \a occludedByLeaf(first, count, ids, nbIds) is
+   * called for each visited leaf with the ids of the rays which reach it,
+   * and must set \a isOccluded[id] for the occluded ones, which are then
+   * dropped from the stream. The wide hierarchies are traversed ray by ray.
+   */
+  template <typename LeafIntersector>
+  void occludedStream(const Ray *rays, const int *ids, int count,
+                      const bool *isOccluded,
+                      const LeafIntersector &occludedByLeaf) const {
+    if (m_params.width == 2) {
+      occludedStreamBinary(rays, ids, count, isOccluded, occludedByLeaf);
+      return;
+    }
+    for (int k = 0; k < count; ++k) {
+      int id = ids[k];
+      occludedLeaves(rays[id], rays[id].tMax, [&](int first, int nbFaces) {
+        occludedByLeaf(first, nbFaces, &id, 1);
+        return isOccluded[id];
+      });
+    }
+  }
+
+  /** Collects in \a roots the subtrees of the binary hierarchy which may
+   * contain primitives visible in \a frustum: the nodes outside of it are
+   * dropped, the ones intersecting it are opened breadth first, as long as
+   * there are at most \a maxRoots subtrees, which are sorted by distance
+   * to the apex of the frustum. \returns false if the hierarchy is not
+   * binary, in which case it cannot be culled. */
+  bool cull(const Frustum &frustum, int maxRoots,
+            std::vector<int> &roots) const;
+
+  /** Same as intersect(), for a ray contained in a frustum culled with
+   * cull(): the traversal starts from the subtrees \a roots rather than
+   * from the root of the hierarchy. */
+  template <typename PrimitiveIntersector>
+  bool intersectCulled(const Ray &ray, Hit &hit,
+                       const std::vector<int> &roots,
+                       const PrimitiveIntersector &intersectPrimitive) const {
+    auto intersectLeaf = [&](int first, int count) {
+      bool found = false;
+      for (int i = first; i < first + count; ++i)
+        found = intersectPrimitive(i) | found;
+      return found;
+    };
+    bool found = false;
+    for (int rootId : roots)
+      found = intersectBinary<false>(ray, hit, intersectLeaf, rootId) | found;
+    return found;
+  }
+
+  /// Packet version of intersectCulled(), see intersectPacket()
+  template <typename PrimitiveIntersector>
+  void intersectPacketCulled(
+      const RayPacket &packet, uint32_t mask, Hit *hits,
+      const std::vector<int> &roots,
+      const PrimitiveIntersector &intersectPrimitive) const {
+    auto intersectLeaf = [&](int first, int count, uint32_t laneMask) {
+      for (int i = first; i < first + count; ++i)
+        intersectPrimitive(i, laneMask);
+    };
+    for (int rootId : roots) {
+      switch (packet.size) {
+      case 4:
+        intersectPacketBinary<4>(packet, mask, hits, intersectLeaf, rootId);
+        break;
+      case 8:
+        intersectPacketBinary<8>(packet, mask, hits, intersectLeaf, rootId);
+        break;
+      default:
+        intersectPacketBinary<16>(packet, mask, hits, intersectLeaf, rootId);
+        break;
+      }
+    }
+  }
+
+  /// \returns the index of the \a i-th primitive in the leaf order
+  int primitiveId(int i) const { return m_faces[i]; }
+  /// \returns the primitive indices in the leaf order, including the padding
+  const std::vector<int> &primitiveIds() const { return m_faces; }
+
+  /// \returns the bounding box of all the primitives
+  const BoundingBox3f &getBoundingBox() const { return m_bbox; }
+
+  /// \returns the number of references added by the spatial splits
+  int nbSplitReferences() const { return m_nbSplitReferences; }
+
+  /// \returns the memory used by the nodes and the primitive indices
+  size_t memoryUsage() const;
+
+  /// \returns the number of primitives the hierarchy was built over
+  int nbPrimitives() const { return m_nbPrimitives; }
+
+  /** Writes the hierarchy (construction parameters, nodes and primitive
+   * indices) to \a os, in the memory layout of this build */
+  void save(std::ostream &os) const;
+
+  /** Reads a hierarchy written by save() from the \a size bytes at \a data,
+   * e.g. a memory-mapped file. \returns false if the data are invalid or
+   * were written with another node layout. */
+  bool load(const char *data, size_t size);
+
 protected:
-  
-  bool intersectNode(int nodeId, const Ray& ray, Hit& hit) const;
-  
+
+  /// Size of the traversal stack, hence maximal depth of the tree
+  static constexpr int StackSize = 64;
+
+  /** Traverses the hierarchy of the selected width. With \a AnyHit, the
+   * traversal stops at the first leaf for which the callback returns true. */
+  template <bool AnyHit, typename LeafIntersector>
+  bool traverse(const Ray &ray, Hit &hit,
+                const LeafIntersector &intersectLeaf) const {
+    switch (m_params.width * 100 + m_params.quantization) {
+    case 400:
+      return intersectWide<AnyHit>(m_nodes4, ray, hit, intersectLeaf);
+    case 408:
+      return intersectWide<AnyHit>(m_nodes4q8, ray, hit, intersectLeaf);
+    case 416:
+      return intersectWide<AnyHit>(m_nodes4q16, ray, hit, intersectLeaf);
+    case 800:
+      return intersectWide<AnyHit>(m_nodes8, ray, hit, intersectLeaf);
+    case 808:
+      return intersectWide<AnyHit>(m_nodes8q8, ray, hit, intersectLeaf);
+    case 816:
+      return intersectWide<AnyHit>(m_nodes8q16, ray, hit, intersectLeaf);
+    default:
+      return intersectBinary<AnyHit>(ray, hit, intersectLeaf);
+    }
+  }
+
+  /// Traversal of the binary subtree \a rootId (the whole hierarchy by default)
+  template <bool AnyHit, typename LeafIntersector>
+  bool intersectBinary(const Ray &ray, Hit &hit,
+                       const LeafIntersector &intersectLeaf,
+                       int rootId = 0) const;
+
+  /// Traversal of the binary subtree \a rootId by packets of N rays
+  template <int N, typename LeafIntersector>
+  void intersectPacketBinary(const RayPacket &packet, uint32_t mask,
+                             Hit *hits, const LeafIntersector &intersectLeaf,
+                             int rootId = 0) const;
+
+  /// Stream traversal of the binary hierarchy, see occludedStream()
+  template <typename LeafIntersector>
+  void occludedStreamBinary(const Ray *rays, const int *ids, int count,
+                            const bool *isOccluded,
+                            const LeafIntersector &occludedByLeaf) const;
+
+  /// Traversal of the wide nodes, either WideNode or QuantizedNode
+  template <bool AnyHit, typename WideNodes, typename LeafIntersector>
+  bool intersectWide(const WideNodes &nodes, const Ray &ray, Hit &hit,
+                     const LeafIntersector &intersectLeaf) const;
+
   int split(int start, int end, int dim, float split_value);
-  
-  void buildNode(int nodeId, int start, int end, int level, int targetCellSize, int maxDepth);
-  
-  const Mesh* m_pMesh;
+
+  /// \returns the bounding box of the faces [start, end)
+  BoundingBox3f computeBounds(int start, int end) const;
+  /// \returns the bounding box of the centroids of the faces [start, end)
+  BoundingBox3f computeCentroidBounds(int start, int end) const;
+
+  /** Searches the binned SAH split of the faces [start, end) over the 3 axes.
+   * \returns false if a leaf is cheaper or if the centroids cannot be
+   * separated, otherwise the split position is returned in \a mid_id, the
+   * split axis in \a axis, and the faces are partitioned accordingly. */
+  bool splitSAH(int start, int end, const BoundingBox3f &aabb, int &mid_id,
+                int &axis);
+
+  /** Builds the subtree of the faces [start, end) in \a tree, where the two
+   * children of an inner node are allocated next to each other (in
+   * second_child_id - 1 and second_child_id). */
+  void buildNode(NodeList &tree, int nodeId, int start, int end, int level);
+
+  /** Linear construction (SPLIT_LBVH and SPLIT_HLBVH): sorts m_faces along
+   * the Morton curve of the centroids, then builds the tree in \a tree */
+  void buildMorton(NodeList &tree);
+
+  /** Builds the subtree of the faces [start, end) of m_faces, sorted by
+   * Morton codes, by splitting them where the highest bit of their codes
+   * changes. \returns the bounds of the subtree. */
+  BoundingBox3f buildMortonNode(NodeList &tree, int nodeId, int start,
+                                int end, int level);
+
+  /** Builds the top levels of SPLIT_HLBVH over the \a clusters [begin, end)
+   * with the SAH, and assigns to each cluster the node of its subtree */
+  void buildClusterNode(NodeList &tree, int nodeId,
+                        std::vector<MortonCluster> &clusters, int begin,
+                        int end, int level);
+
+  /** Spatial split version of buildNode(): builds the subtree of the
+   * references \a refs, which are consumed. The primitives of the leaves are
+   * written to m_faces, at the positions allocated with m_nbReferences. */
+  void buildSpatialNode(NodeList &tree, int nodeId, ReferenceList &refs,
+                        int level);
+
+  /** Searches the best object split of the references \a refs of bounds
+   * \a box (binned SAH over the centroids of the references). The cost is
+   * left to infinity if the references cannot be separated. */
+  void findObjectSplit(const ReferenceList &refs, const BoundingBox3f &box,
+                       SplitCandidate &split) const;
+
+  /** Searches the best spatial split of the references \a refs of bounds
+   * \a box, among the planes between the bins of each axis, which does not
+   * exceed the duplication budget */
+  void findSpatialSplit(const ReferenceList &refs, const BoundingBox3f &box,
+                        SplitCandidate &split) const;
+
+  /** Copies the subtree \a nodeId of \a tree in depth-first order in m_nodes,
+   * starting at index \a offset, and appends the faces of its leaves to
+   * m_faces in the same order. \returns the index following the subtree. */
+  int flattenNode(const NodeList &tree, const std::vector<int> &faces,
+                  int nodeId, int offset);
+
+  /** Creates in \a nodes the N-wide node corresponding to the binary node
+   * \a nodeId, by opening its largest inner descendants until it has N
+   * children, and recursively. \returns the index of the wide node. */
+  template <int N> int collapseNode(WideNodeList<N> &nodes, int nodeId);
+
+  /// Fills \a quantized with the compressed version of \a nodes
+  template <int N, typename Q>
+  static void quantizeNodes(const WideNodeList<N> &nodes,
+                            QuantizedNodeList<N, Q> &quantized);
+
+  /// Stores the exact bounds of \a node in \a dst, compressed or not
+  template <int N>
+  static void encodeNode(const WideNode<N> &node, WideNode<N> &dst) {
+    dst = node;
+  }
+  template <int N, typename Q>
+  static void encodeNode(const WideNode<N> &node, QuantizedNode<N, Q> &dst);
+
+  /// \returns the bounds of the primitives of the leaf [first, first+count)
+  BoundingBox3f leafBounds(const std::vector<BoundingBox3f> &bounds,
+                           int first, int count) const;
+
+  /** Refits the binary subtree \a nodeId, which spans the nodes
+   * [nodeId, end) in depth-first order. \returns its bounds. */
+  BoundingBox3f refitBinary(int nodeId, int end,
+                            const std::vector<BoundingBox3f> &bounds);
+
+  /// Refits the wide subtree \a nodeId. \returns its bounds.
+  template <typename WideNodes>
+  BoundingBox3f refitWide(WideNodes &nodes, int nodeId,
+                          const std::vector<BoundingBox3f> &bounds, int level);
+
+  /// SAH cost of the wide hierarchy \a nodes, see sahCost()
+  template <typename WideNodes> float wideSahCost(const WideNodes &nodes) const;
+
+  /** Signature written by save(): format version and sizes of the node types,
+   * which depend on the instruction set (alignment of the Eigen types) */
+  static std::vector<uint32_t> fileSignature();
+
   NodeList m_nodes;
+  /// Collapsed hierarchies, the binary one is released when they are used
+  WideNodeList<4> m_nodes4;
+  WideNodeList<8> m_nodes8;
+  /// Compressed hierarchies, the float ones are released when they are used
+  QuantizedNodeList<4, uint8_t> m_nodes4q8;
+  QuantizedNodeList<4, uint16_t> m_nodes4q16;
+  QuantizedNodeList<8, uint8_t> m_nodes8q8;
+  QuantizedNodeList<8, uint16_t> m_nodes8q16;
+  BoundingBox3f m_bbox;
+  /// Primitive indices, sorted such that each leaf covers a contiguous range
   std::vector<int> m_faces;
+  /** Centroids and bounds of the primitives (indexed by primitive index, the
+   * bounds are sorted like m_faces by the linear construction), only used
+   * during the construction */
   std::vector<Point3f> m_centroids;
+  std::vector<BoundingBox3f> m_bounds;
+  /// Sorted Morton codes of m_faces, only used by the linear construction
+  std::vector<uint64_t> m_mortonCodes;
+
+  BuildParams m_params;
+  int m_nbPrimitives = 0;
+  /// SAH cost after the construction, to measure the refits
+  float m_buildSahCost = 0.f;
+  /// Number of nodes allocated in m_nodes during the construction
+  std::atomic<int> m_nbNodes;
+
+  /// Clipping of the primitives for the spatial splits
+  PrimitiveSplitter m_splitPrimitive;
+  /// Number of references written to m_faces by buildSpatialNode()
+  std::atomic<int> m_nbReferences;
+  /// Number of references the spatial splits may still add
+  std::atomic<int> m_splitBudget;
+  int m_nbSplitReferences = 0;
+  /// Surface area of the root, to which the overlaps are compared
+  float m_rootArea;
 
-  SplitMethod m_splitMethod;
-  BucketInfo m_buckets[nBuckets];
-  
 };
 
+template <bool AnyHit, typename LeafIntersector>
+bool BVH::intersectBinary(const Ray &ray, Hit &hit,
+                          const LeafIntersector &intersectLeaf,
+                          int rootId) const {
+  if (m_nodes.empty())
+    return false;
+
+  int stack[StackSize];
+  int stackSize = 0;
+  int nodeId = rootId;
+  long int nbVisited = 0;
+  bool found = false;
+  while (true) {
+    const Node &node = m_nodes[nodeId];
+    ++nbVisited;
+    float tMin, tMax;
+    if (node.box.rayIntersect(ray, tMin, tMax) && tMin < hit.t) {
+      if (node.is_leaf) {
+        found = intersectLeaf(node.first_face_id, node.nb_faces) | found;
+        if (AnyHit && found)
+          break;
+      } else {
+        // visit first the child on the side the ray comes from
+        if (ray.sign[node.axis]) {
+          stack[stackSize++] = nodeId + 1;
+          nodeId = node.second_child_id;
+        } else {
+          stack[stackSize++] = node.second_child_id;
+          nodeId = nodeId + 1;
+        }
+        continue;
+      }
+    }
+    if (stackSize == 0)
+      break;
+    nodeId = stack[--stackSize];
+  }
+  RayStats::local().nodesVisited += nbVisited;
+  return found;
+}
+
+template <int N, typename LeafIntersector>
+void BVH::intersectPacketBinary(const RayPacket &packet, uint32_t mask,
+                                Hit *hits,
+                                const LeafIntersector &intersectLeaf,
+                                int rootId) const {
+  typedef Eigen::Array<float, N, 1> Lanes;
+  typedef Eigen::Map<const Lanes, Eigen::AlignedMax> LanesMap;
+  if (m_nodes.empty())
+    return;
+
+  const Lanes tMinRay = LanesMap(packet.tMin);
+  const Lanes tMaxRay = LanesMap(packet.tMax);
+  Lanes tHit;
+  for (int lane = 0; lane < N; ++lane)
+    tHit[lane] = hits[lane].t;
+
+  // each entry records the rays which hit its parent
+  struct StackEntry {
+    int nodeId;
+    uint32_t mask;
+  };
+  StackEntry stack[StackSize];
+  int stackSize = 0;
+  int nodeId = rootId;
+  mask &= packet.activeMask;
+  long int nbVisited = 0;
+  while (mask) {
+    const Node &node = m_nodes[nodeId];
+    ++nbVisited;
+    // slab test of the N rays at once, as BoundingBox3f::rayIntersect()
+    Lanes tNear = tMinRay, tFar = tMaxRay;
+    for (int dim = 0; dim < 3; ++dim) {
+      const LanesMap origin(packet.origin[dim]);
+      const LanesMap invDirection(packet.invDirection[dim]);
+      const LanesMap sign(packet.sign[dim]);
+      Lanes tLower = (node.box.min[dim] - origin) * invDirection;
+      Lanes tUpper = (node.box.max[dim] - origin) * invDirection;
+      Lanes t1 = (sign > 0.f).select(tUpper, tLower);
+      Lanes t2 = (sign > 0.f).select(tLower, tUpper);
+      tNear = (t1 > tNear).select(t1, tNear);
+      tFar = (t2 < tFar).select(t2, tFar);
+    }
+    uint32_t hitMask = 0;
+    for (int lane = 0; lane < N; ++lane) {
+      if (tNear[lane] <= tFar[lane] && tNear[lane] < tHit[lane])
+        hitMask |= 1u << lane;
+    }
+    hitMask &= mask;
+
+    if (hitMask && node.is_leaf) {
+      intersectLeaf(node.first_face_id, node.nb_faces, hitMask);
+      for (int lane = 0; lane < N; ++lane)
+        tHit[lane] = hits[lane].t;
+    } else if (hitMask) {
+      // visit first the child on the side the first active ray comes from
+      int lane = 0;
+      while (!((hitMask >> lane) & 1))
+        ++lane;
+      if (packet.rays[lane].sign[node.axis]) {
+        stack[stackSize++] = {nodeId + 1, hitMask};
+        nodeId = node.second_child_id;
+      } else {
+        stack[stackSize++] = {node.second_child_id, hitMask};
+        nodeId = nodeId + 1;
+      }
+      mask = hitMask;
+      continue;
+    }
+    if (stackSize == 0)
+      break;
+    --stackSize;
+    nodeId = stack[stackSize].nodeId;
+    mask = stack[stackSize].mask;
+  }
+  RayStats::local().nodesVisited += nbVisited;
+}
+
+template <typename LeafIntersector>
+void BVH::occludedStreamBinary(const Ray *rays, const int *ids, int count,
+                               const bool *isOccluded,
+                               const LeafIntersector &occludedByLeaf) const {
+  if (m_nodes.empty() || count == 0)
+    return;
+
+  /* The ids of the rays of each stack entry are stored in a shared buffer,
+   * above the ones of the entries below it: the rays hitting a node are
+   * written after the ones of its parent, and the space of an entry is
+   * reused once it is popped. */
+  std::vector<int> buffer(ids, ids + count);
+  struct StackEntry {
+    int nodeId;
+    int begin, end;
+  };
+  StackEntry stack[StackSize];
+  int stackSize = 0;
+  StackEntry entry = {0, 0, count};
+  long int nbVisited = 0;
+  while (true) {
+    const Node &node = m_nodes[entry.nodeId];
+    nbVisited += entry.end - entry.begin;
+    int begin = entry.end;
+    if (int(buffer.size()) < 2 * begin - entry.begin)
+      buffer.resize(2 * begin - entry.begin);
+    int end = begin;
+    // the rays of the stream whose direction is negative along the split axis
+    int nbNegative = 0;
+    for (int k = entry.begin; k < entry.end; ++k) {
+      int id = buffer[k];
+      float tMin, tMax;
+      if (isOccluded[id] || !node.box.rayIntersect(rays[id], tMin, tMax))
+        continue;
+      buffer[end++] = id;
+      nbNegative += rays[id].sign[node.axis];
+    }
+
+    if (end > begin && node.is_leaf) {
+      occludedByLeaf(node.first_face_id, node.nb_faces, &buffer[begin],
+                     end - begin);
+    } else if (end > begin) {
+      // visit first the child on the side most of the rays come from
+      int first = entry.nodeId + 1, second = node.second_child_id;
+      if (2 * nbNegative > end - begin)
+        std::swap(first, second);
+      stack[stackSize++] = {second, begin, end};
+      entry = {first, begin, end};
+      continue;
+    }
+    if (stackSize == 0)
+      break;
+    entry = stack[--stackSize];
+  }
+  RayStats::local().nodesVisited += nbVisited;
+}
+
+template <bool AnyHit, typename WideNodes, typename LeafIntersector>
+bool BVH::intersectWide(const WideNodes &nodes, const Ray &ray, Hit &hit,
+                        const LeafIntersector &intersectLeaf) const {
+  typedef typename WideNodes::value_type WideNodeType;
+  typedef typename WideNodeType::Lanes Lanes;
+  constexpr int N = WideNodeType::Width;
+  if (nodes.empty())
+    return false;
+
+  // an entry is either an inner node or a leaf, with its entry distance
+  struct StackEntry {
+    float tMin;
+    int child;
+    int nb_faces;
+  };
+  StackEntry stack[StackSize * N];
+  int stackSize = 0;
+  stack[stackSize++] = {-std::numeric_limits<float>::infinity(), 0, 0};
+
+  long int nbVisited = 0;
+  bool found = false;
+  while (stackSize > 0) {
+    const StackEntry entry = stack[--stackSize];
+    if (entry.tMin >= hit.t)
+      continue;
+    if (entry.nb_faces > 0) {
+      found = intersectLeaf(entry.child, entry.nb_faces) | found;
+      if (AnyHit && found)
+        break;
+      continue;
+    }
+
+    const WideNodeType &node = nodes[entry.child];
+    ++nbVisited;
+    // slab test of the N children at once, the sign of the direction gives
+    // the near and far planes of each axis
+    Lanes tNear = Lanes::Constant(ray.tMin);
+    Lanes tFar = Lanes::Constant(std::min(hit.t, ray.tMax));
+    for (int dim = 0; dim < 3; ++dim) {
+      Lanes lower, upper;
+      node.childBounds(dim, lower, upper);
+      const Lanes &nearPlane = ray.sign[dim] ? upper : lower;
+      const Lanes &farPlane = ray.sign[dim] ? lower : upper;
+      tNear = tNear.max((nearPlane - ray.origin[dim]) * ray.invDirection[dim]);
+      tFar = tFar.min((farPlane - ray.origin[dim]) * ray.invDirection[dim]);
+    }
+
+    // push the children hit by the ray, the nearest one on top of the stack
+    int first = stackSize;
+    for (int i = 0; i < N; ++i) {
+      if (node.nb_faces[i] < 0 || !(tNear[i] <= tFar[i]))
+        continue;
+      StackEntry child = {tNear[i], node.child[i], node.nb_faces[i]};
+      int j = stackSize++;
+      for (; j > first && stack[j - 1].tMin < child.tMin; --j)
+        stack[j] = stack[j - 1];
+      stack[j] = child;
+    }
+  }
+  RayStats::local().nodesVisited += nbVisited;
+  return found;
+}
+
 #endif
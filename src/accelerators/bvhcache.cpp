@@ -0,0 +1,146 @@
+#include "accelerators/bvhcache.h"
+#include "mappedfile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem/path.h>
+#include <fstream>
+#include <iostream>
+
+std::string BVHCache::ms_directory;
+
+namespace {
+
+/// Header of the entries, followed by the data written by BVH::save()
+struct EntryHeader {
+  uint64_t sourceHash;
+  uint64_t sourceSize;
+};
+
+/// 64-bit FNV-1a hash, applied to 8-byte words for speed
+struct Hash {
+  uint64_t value = 0xcbf29ce484222325ull;
+
+  void add(uint64_t word) { value = (value ^ word) * 0x100000001b3ull; }
+
+  void add(const char *data, size_t size) {
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+      uint64_t word;
+      std::memcpy(&word, data + i, 8);
+      add(word);
+    }
+    uint64_t tail = 0;
+    std::memcpy(&tail, data + i, size - i);
+    add(tail ^ size);
+  }
+
+  void add(const std::string &str) { add(str.data(), str.size()); }
+
+  void add(float f) {
+    uint32_t bits;
+    std::memcpy(&bits, &f, 4);
+    add(uint64_t(bits));
+  }
+};
+
+} // namespace
+
+BVHCache::BVHCache(const std::string &filename, uint32_t loaderVersion,
+                   const BVH::BuildParams &params)
+    : m_sourceHash(0), m_sourceSize(0) {
+  if (ms_directory.empty() || filename.empty())
+    return;
+  MappedFile source(filename);
+  if (!source.valid())
+    return;
+  Hash content;
+  content.add(source.data(), source.size());
+  m_sourceHash = content.value;
+  m_sourceSize = source.size();
+
+  Hash key;
+  key.add(filesystem::path(filename).make_absolute().str());
+  key.add(uint64_t(loaderVersion));
+  key.add(uint64_t(params.splitMethod));
+  key.add(uint64_t(params.targetCellSize));
+  key.add(uint64_t(params.maxDepth));
+  key.add(uint64_t(params.nbBins));
+  key.add(params.traversalCost);
+  key.add(uint64_t(params.width));
+  key.add(uint64_t(params.leafAlignment));
+  key.add(uint64_t(params.quantization));
+  key.add(params.splitBudget);
+  char name[17];
+  std::snprintf(name, sizeof(name), "%016llx",
+                (unsigned long long)key.value);
+  m_entry = (filesystem::path(ms_directory) /
+             (filesystem::path(filename).filename() + "-" + name + ".bvh"))
+                .str();
+}
+
+bool BVHCache::load(BVH &bvh, int nbPrimitives) const {
+  if (!enabled())
+    return false;
+  MappedFile file(m_entry);
+  if (!file.valid()) {
+    cout << "BVH cache miss: " << m_entry << endl;
+    return false;
+  }
+  EntryHeader header;
+  if (file.size() < sizeof(header)) {
+    cout << "BVH cache entry " << m_entry << " is corrupted, rebuilding"
+         << endl;
+    return false;
+  }
+  std::memcpy(&header, file.data(), sizeof(header));
+  if (header.sourceHash != m_sourceHash ||
+      header.sourceSize != m_sourceSize) {
+    cout << "BVH cache entry " << m_entry
+         << " is stale (the mesh file changed), rebuilding" << endl;
+    return false;
+  }
+  if (!bvh.load(file.data() + sizeof(header), file.size() - sizeof(header)) ||
+      bvh.nbPrimitives() != nbPrimitives) {
+    cout << "BVH cache entry " << m_entry
+         << " is corrupted or was written by another build, rebuilding"
+         << endl;
+    return false;
+  }
+  cout << "BVH cache hit: " << m_entry << endl;
+  return true;
+}
+
+void BVHCache::store(const BVH &bvh) const {
+  if (!enabled())
+    return;
+  // written aside then renamed, so that an entry is never partially written
+  std::string tmpName = m_entry + ".tmp";
+  {
+    std::ofstream os(tmpName, std::ios::binary);
+    EntryHeader header = {m_sourceHash, m_sourceSize};
+    os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    bvh.save(os);
+    if (!os) {
+      std::cerr << "BVH cache: unable to write " << tmpName << std::endl;
+      return;
+    }
+  }
+#if defined(_WIN32)
+  std::remove(m_entry.c_str());
+#endif
+  if (std::rename(tmpName.c_str(), m_entry.c_str()) != 0) {
+    std::cerr << "BVH cache: unable to write " << m_entry << std::endl;
+    std::remove(tmpName.c_str());
+  }
+}
+
+void BVHCache::setDirectory(const std::string &directory) {
+  if (!directory.empty()) {
+    filesystem::path path(directory);
+    if (!path.exists() && !filesystem::create_directories(path))
+      throw RTException("BVHCache: unable to create the directory \"%s\"",
+                        directory);
+  }
+  ms_directory = directory;
+}
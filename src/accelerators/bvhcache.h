@@ -0,0 +1,54 @@
+#ifndef BVHCACHE_H
+#define BVHCACHE_H
+
+#include <cstdint>
+#include <string>
+#include "accelerators/bvh.h"
+
+/** \class BVHCache
+ * On-disk cache of the hierarchies of the meshes, which skips their
+ * construction when a scene is loaded again.
+ *
+ * It is disabled until a directory is given to setDirectory() (command line
+ * option --bvh-cache). An entry is named after the mesh file and a hash of
+ * its absolute path, of the version of the mesh loader and of the
+ * construction parameters. It records a hash of
+ * the content of the mesh file: when this content changes, the entry is
+ * stale and is rebuilt and overwritten. The entries are written in the memory
+ * layout of the nodes, and read back through a memory mapping of the file.
+ */
+class BVHCache {
+public:
+  /** Hashes the content of the mesh file \a filename if the cache is enabled
+   * and \a filename is not empty. \a loaderVersion identifies how the
+   * primitives are built from the file (see Mesh::LoaderVersion): the
+   * entries of another version are not used. */
+  BVHCache(const std::string &filename, uint32_t loaderVersion,
+           const BVH::BuildParams &params);
+
+  /** Reads the cached hierarchy of the mesh into \a bvh, and reports the hit
+   * or the miss on the console.
+   * \returns false on a miss: the hierarchy must then be built and store()d */
+  bool load(BVH &bvh, int nbPrimitives) const;
+
+  /// Writes the hierarchy \a bvh of the mesh to the cache
+  void store(const BVH &bvh) const;
+
+  bool enabled() const { return !m_entry.empty(); }
+
+  /** Enables the cache in \a directory, created if needed, or disables it if
+   * \a directory is empty */
+  static void setDirectory(const std::string &directory);
+  static const std::string &directory() { return ms_directory; }
+
+private:
+  /// Path of the entry, empty when the cache is disabled
+  std::string m_entry;
+  /// Hash and size of the content of the mesh file
+  uint64_t m_sourceHash;
+  uint64_t m_sourceSize;
+
+  static std::string ms_directory;
+};
+
+#endif
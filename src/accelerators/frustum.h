@@ -0,0 +1,64 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include "accelerators/bbox.h"
+
+/** \class Frustum
+ * Pyramid of apex \a origin bounded by 4 side planes, e.g. the part of the
+ * camera field of view seen through an image block. It has no near nor far
+ * plane: it contains all the rays leaving the apex between its edges.
+ *
+ * The boxes are classified against the planes with the usual test of their
+ * nearest and farthest corners along the plane normals, which is
+ * conservative: a box may be reported as intersecting while it is outside.
+ */
+class Frustum {
+public:
+  enum ECullResult { EOutside = 0, EIntersecting, EInside };
+
+  Frustum() = default;
+
+  /** Frustum of apex \a origin whose edges have the directions \a edges,
+   * given in order around the pyramid (either orientation) */
+  Frustum(const Point3f &origin, const Vector3f edges[4]) : m_origin(origin) {
+    Vector3f center = edges[0] + edges[1] + edges[2] + edges[3];
+    for (int i = 0; i < 4; ++i) {
+      Vector3f n = edges[i].cross(edges[(i + 1) % 4]).normalized();
+      // the normals point to the inside of the pyramid
+      if (n.dot(center) < 0.f)
+        n = -n;
+      m_normals[i] = n;
+      m_offsets[i] = -n.dot(origin);
+    }
+  }
+
+  /// Apex of the pyramid
+  const Point3f &origin() const { return m_origin; }
+
+  /// Position of \a box relative to the frustum
+  ECullResult classify(const BoundingBox3f &box) const {
+    ECullResult result = EInside;
+    for (int i = 0; i < 4; ++i) {
+      const Vector3f &n = m_normals[i];
+      // corners of the box farthest inside and outside the plane
+      Point3f inner, outer;
+      for (int dim = 0; dim < 3; ++dim) {
+        inner[dim] = n[dim] > 0.f ? box.max[dim] : box.min[dim];
+        outer[dim] = n[dim] > 0.f ? box.min[dim] : box.max[dim];
+      }
+      if (n.dot(inner) + m_offsets[i] < 0.f)
+        return EOutside;
+      if (n.dot(outer) + m_offsets[i] < 0.f)
+        result = EIntersecting;
+    }
+    return result;
+  }
+
+private:
+  Point3f m_origin;
+  /// Side planes n.p + offset = 0, the inside being n.p + offset >= 0
+  Vector3f m_normals[4];
+  float m_offsets[4];
+};
+
+#endif
@@ -0,0 +1,178 @@
+#include "accelerators/kdtree.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <tbb/parallel_invoke.h>
+
+/* Below this number of primitives, the subtrees are built sequentially as
+ * the overhead of the TBB tasks outweighs the gain */
+static const int ParallelSubtreeThreshold = 1 << 12;
+
+/// Surface area of a box of extents \a d
+static float boxArea(const Vector3f &d) {
+  return 2.f * (d[0] * d[1] + d[0] * d[2] + d[1] * d[2]);
+}
+
+void KDTree::build(const std::vector<BoundingBox3f> &bounds,
+                   const BuildParams &params) {
+  m_params = params;
+  m_nbPrimitives = bounds.size();
+  m_nodes.clear();
+  m_primitives.clear();
+  m_bbox.reset();
+  if (bounds.empty())
+    return;
+
+  m_bounds = bounds;
+  for (const BoundingBox3f &box : bounds)
+    m_bbox.expandBy(box);
+  if (m_params.maxDepth < 0)
+    m_params.maxDepth =
+        std::lround(8.f + 1.3f * std::log2(float(m_nbPrimitives)));
+  // each inner node on the path to a leaf pushes at most one traversal entry
+  m_params.maxDepth = std::min(m_params.maxDepth, StackSize - 1);
+
+  std::vector<int> prims(m_nbPrimitives);
+  std::iota(prims.begin(), prims.end(), 0);
+  buildNode(m_nodes, m_primitives, m_bbox, prims, m_params.maxDepth, 0);
+  m_nodes.shrink_to_fit();
+  m_primitives.shrink_to_fit();
+
+  // release the construction data
+  std::vector<BoundingBox3f>().swap(m_bounds);
+}
+
+void KDTree::buildNode(NodeList &nodes, std::vector<int> &leafPrimitives,
+                       const BoundingBox3f &box, std::vector<int> &prims,
+                       int depth, int badRefines) const {
+  int nodeId = nodes.size();
+  nodes.emplace_back();
+  int nbPrims = prims.size();
+  if (nbPrims <= m_params.targetCellSize || depth == 0) {
+    nodes[nodeId].initLeaf(leafPrimitives.size(), nbPrims);
+    leafPrimitives.insert(leafPrimitives.end(), prims.begin(), prims.end());
+    return;
+  }
+
+  // SAH over the planes at the edges of the primitives, along the 3 axes
+  Vector3f extents = box.getExtents();
+  float invArea = 1.f / boxArea(extents);
+  float leafCost = m_params.intersectCost * nbPrims;
+  float bestCost = std::numeric_limits<float>::infinity();
+  int bestAxis = -1, bestEdge = 0;
+  std::vector<BoundEdge> edges(2 * nbPrims), bestEdges;
+  for (int dim = 0; dim < 3; ++dim) {
+    for (int i = 0; i < nbPrims; ++i) {
+      const BoundingBox3f &b = m_bounds[prims[i]];
+      edges[2 * i] = {b.min[dim], prims[i], true};
+      edges[2 * i + 1] = {b.max[dim], prims[i], false};
+    }
+    std::sort(edges.begin(), edges.end());
+
+    // area of the face of the cell orthogonal to dim, and its perimeter
+    int dim1 = (dim + 1) % 3, dim2 = (dim + 2) % 3;
+    float faceArea = extents[dim1] * extents[dim2];
+    float perimeter = extents[dim1] + extents[dim2];
+    bool improved = false;
+    int nbBelow = 0, nbAbove = nbPrims;
+    for (int i = 0; i < 2 * nbPrims; ++i) {
+      if (!edges[i].start)
+        --nbAbove;
+      float t = edges[i].t;
+      if (t > box.min[dim] && t < box.max[dim]) {
+        float belowArea = 2.f * (faceArea + (t - box.min[dim]) * perimeter);
+        float aboveArea = 2.f * (faceArea + (box.max[dim] - t) * perimeter);
+        float bonus = (nbBelow == 0 || nbAbove == 0) ? m_params.emptyBonus
+                                                     : 0.f;
+        float cost = m_params.traversalCost +
+                     m_params.intersectCost * (1.f - bonus) *
+                         (belowArea * nbBelow + aboveArea * nbAbove) *
+                         invArea;
+        if (cost < bestCost) {
+          bestCost = cost;
+          bestAxis = dim;
+          bestEdge = i;
+          improved = true;
+        }
+      }
+      if (edges[i].start)
+        ++nbBelow;
+    }
+    if (improved)
+      bestEdges.swap(edges);
+    edges.resize(2 * nbPrims);
+  }
+
+  if (bestCost > leafCost)
+    ++badRefines;
+  if (bestAxis < 0 || (bestCost > 4.f * leafCost && nbPrims < 16) ||
+      badRefines == 3) {
+    nodes[nodeId].initLeaf(leafPrimitives.size(), nbPrims);
+    leafPrimitives.insert(leafPrimitives.end(), prims.begin(), prims.end());
+    return;
+  }
+
+  // the primitives starting before the plane go below, the ones ending after
+  // it above
+  std::vector<int> below, above;
+  for (int i = 0; i < bestEdge; ++i) {
+    if (bestEdges[i].start)
+      below.push_back(bestEdges[i].prim);
+  }
+  for (int i = bestEdge + 1; i < 2 * nbPrims; ++i) {
+    if (!bestEdges[i].start)
+      above.push_back(bestEdges[i].prim);
+  }
+  float split = bestEdges[bestEdge].t;
+  std::vector<BoundEdge>().swap(edges);
+  std::vector<BoundEdge>().swap(bestEdges);
+  std::vector<int>().swap(prims);
+
+  BoundingBox3f belowBox = box, aboveBox = box;
+  belowBox.max[bestAxis] = split;
+  aboveBox.min[bestAxis] = split;
+  if (nbPrims >= ParallelSubtreeThreshold) {
+    NodeList belowNodes, aboveNodes;
+    std::vector<int> belowLeafPrimitives, aboveLeafPrimitives;
+    tbb::parallel_invoke(
+        [&] {
+          buildNode(belowNodes, belowLeafPrimitives, belowBox, below,
+                    depth - 1, badRefines);
+        },
+        [&] {
+          buildNode(aboveNodes, aboveLeafPrimitives, aboveBox, above,
+                    depth - 1, badRefines);
+        });
+    appendSubtree(nodes, leafPrimitives, belowNodes, belowLeafPrimitives);
+    nodes[nodeId].initInner(bestAxis, split, nodes.size());
+    appendSubtree(nodes, leafPrimitives, aboveNodes, aboveLeafPrimitives);
+  } else {
+    buildNode(nodes, leafPrimitives, belowBox, below, depth - 1, badRefines);
+    nodes[nodeId].initInner(bestAxis, split, nodes.size());
+    buildNode(nodes, leafPrimitives, aboveBox, above, depth - 1, badRefines);
+  }
+}
+
+void KDTree::appendSubtree(NodeList &nodes, std::vector<int> &leafPrimitives,
+                           const NodeList &subtree,
+                           const std::vector<int> &subtreePrims) {
+  int nodeOffset = nodes.size();
+  int primOffset = leafPrimitives.size();
+  nodes.reserve(nodes.size() + subtree.size());
+  for (Node node : subtree) {
+    if (node.isLeaf())
+      node.firstPrimitive += primOffset;
+    else
+      node.initInner(node.axis(), node.split,
+                     node.secondChild() + nodeOffset);
+    nodes.push_back(node);
+  }
+  leafPrimitives.insert(leafPrimitives.end(), subtreePrims.begin(),
+                        subtreePrims.end());
+}
+
+size_t KDTree::memoryUsage() const {
+  return m_nodes.capacity() * sizeof(Node) +
+         m_primitives.capacity() * sizeof(int);
+}
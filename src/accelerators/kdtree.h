@@ -0,0 +1,223 @@
+#ifndef KDTREE_H
+#define KDTREE_H
+
+#include <cstdint>
+#include <vector>
+#include "ray.h"
+#include "stats.h"
+#include "accelerators/bbox.h"
+
+/** \class KDTree
+ * kd-tree over a set of primitives given by their axis-aligned bounding
+ * boxes, with the same interface as the BVH (see accelerator.h).
+ *
+ * The tree is built with the SAH over the sorted edges of the bounds of the
+ * primitives (Wald and Havran, "On building fast kd-trees for ray tracing,
+ * and on doing that in O(N log N)", 2006, in its O(N log^2 N) variant), and
+ * traversed front to back: unlike the BVH, the cells do not overlap, so that
+ * the traversal stops at the first cell containing a hit. A primitive
+ * straddling a split plane is referenced by both children. The subtrees of
+ * the large nodes are built as independent TBB tasks.
+ */
+class KDTree {
+
+  /** Nodes are stored in depth-first order: the first child of an inner node
+   * immediately follows it, only the index of the second child is stored. */
+  struct Node {
+    union {
+      float split;        // position of the split plane of inner nodes
+      int firstPrimitive; // first position in m_primitives of the leaves
+    };
+    /** 2 low bits: split axis, or 3 for the leaves. Other bits: index of the
+     * second child of inner nodes, or number of primitives of the leaves. */
+    uint32_t flags;
+
+    bool isLeaf() const { return (flags & 3) == 3; }
+    int axis() const { return flags & 3; }
+    int secondChild() const { return flags >> 2; }
+    int nbPrimitives() const { return flags >> 2; }
+
+    void initLeaf(int first, int count) {
+      firstPrimitive = first;
+      flags = (uint32_t(count) << 2) | 3;
+    }
+    void initInner(int dim, float position, int second) {
+      split = position;
+      flags = (uint32_t(second) << 2) | dim;
+    }
+  };
+
+  typedef std::vector<Node> NodeList;
+
+  /// Start or end of the bounds of a primitive along the split axis
+  struct BoundEdge {
+    float t;
+    int prim;
+    bool start;
+
+    bool operator<(const BoundEdge &e) const {
+      return t == e.t ? start && !e.start : t < e.t;
+    }
+  };
+
+public:
+
+  /// Parameters of the construction of the tree
+  struct BuildParams {
+    /// Cost of a primitive intersection relative to traversing a node
+    float intersectCost = 80.f;
+    float traversalCost = 1.f;
+    /// Reduction of the cost of the splits with an empty child
+    float emptyBonus = .5f;
+    /// Number of primitives below which a node is not split
+    int targetCellSize = 1;
+    /** Maximal depth, 8 + 1.3 log2(n) if negative, bounded by the size of
+     * the traversal stack */
+    int maxDepth = -1;
+  };
+
+  /** Builds the tree over the primitives whose bounding boxes are given in
+   * \a bounds. The i-th box corresponds to the primitive index i. */
+  void build(const std::vector<BoundingBox3f> &bounds,
+             const BuildParams &params);
+
+  /** Search the nearest intersection between the ray and the primitives.
+   * \a intersectPrimitive(i) is called for each primitive of the visited
+   * leaves, where \a i is the position of the primitive in the leaf order
+   * (see primitiveId()). It must return true and shorten \a hit.t when it
+   * finds a closer intersection. A primitive referenced by several leaves may
+   * be tested several times. */
+  template <typename PrimitiveIntersector>
+  bool intersect(const Ray &ray, Hit &hit,
+                 const PrimitiveIntersector &intersectPrimitive) const {
+    return traverse<false>(ray, hit, intersectPrimitive);
+  }
+
+  /** \returns true if any primitive is hit before \a tMax, stopping at the
+   * first one found. \a occludedByPrimitive(i) must return true if the
+   * primitive at position \a i in the leaf order is hit before \a tMax. */
+  template <typename PrimitiveIntersector>
+  bool occluded(const Ray &ray, float tMax,
+                const PrimitiveIntersector &occludedByPrimitive) const {
+    Hit hit;
+    hit.t = tMax;
+    return traverse<true>(ray, hit, occludedByPrimitive);
+  }
+
+  /// \returns the index of the \a i-th primitive in the leaf order
+  int primitiveId(int i) const { return m_primitives[i]; }
+  /// \returns the primitive indices in the leaf order
+  const std::vector<int> &primitiveIds() const { return m_primitives; }
+
+  /// \returns the bounding box of all the primitives
+  const BoundingBox3f &getBoundingBox() const { return m_bbox; }
+
+  /// \returns the number of primitives the tree was built over
+  int nbPrimitives() const { return m_nbPrimitives; }
+
+  /// \returns the number of nodes of the tree
+  int nbNodes() const { return m_nodes.size(); }
+
+  /// \returns the memory used by the nodes and the primitive indices
+  size_t memoryUsage() const;
+
+protected:
+
+  /// Size of the traversal stack, hence maximal depth of the tree
+  static constexpr int StackSize = 64;
+
+  /** Traverses the cells pierced by the ray front to back. With \a AnyHit,
+   * the traversal stops at the first primitive for which the callback
+   * returns true. */
+  template <bool AnyHit, typename PrimitiveIntersector>
+  bool traverse(const Ray &ray, Hit &hit,
+                const PrimitiveIntersector &intersectPrimitive) const;
+
+  /** Builds the subtree of the primitives \a prims, contained in \a box,
+   * appending its nodes to \a nodes and the primitives of its leaves to
+   * \a leafPrimitives. \a badRefines counts the splits on the path from the
+   * root which did not reduce the cost. */
+  void buildNode(NodeList &nodes, std::vector<int> &leafPrimitives,
+                 const BoundingBox3f &box, std::vector<int> &prims,
+                 int depth, int badRefines) const;
+
+  /** Appends the subtree \a subtree and its leaf primitives \a subtreePrims,
+   * built apart, to \a nodes and \a leafPrimitives */
+  static void appendSubtree(NodeList &nodes, std::vector<int> &leafPrimitives,
+                            const NodeList &subtree,
+                            const std::vector<int> &subtreePrims);
+
+  NodeList m_nodes;
+  BoundingBox3f m_bbox;
+  /// Primitive indices, sorted such that each leaf covers a contiguous range
+  std::vector<int> m_primitives;
+  /// Bounds of the primitives, only used during the construction
+  std::vector<BoundingBox3f> m_bounds;
+
+  BuildParams m_params;
+  int m_nbPrimitives = 0;
+};
+
+template <bool AnyHit, typename PrimitiveIntersector>
+bool KDTree::traverse(const Ray &ray, Hit &hit,
+                      const PrimitiveIntersector &intersectPrimitive) const {
+  float tMin, tMax;
+  if (m_nodes.empty() || !m_bbox.rayIntersect(ray, tMin, tMax))
+    return false;
+
+  // cells still to visit, with the part of the ray inside them
+  struct StackEntry {
+    int nodeId;
+    float tMin, tMax;
+  };
+  StackEntry stack[StackSize];
+  int stackSize = 0;
+  int nodeId = 0;
+  long int nbVisited = 0;
+  bool found = false;
+  while (true) {
+    // the remaining cells are behind the closest hit
+    if (hit.t < tMin)
+      break;
+    const Node &node = m_nodes[nodeId];
+    ++nbVisited;
+    if (!node.isLeaf()) {
+      int dim = node.axis();
+      float tPlane = (node.split - ray.origin[dim]) * ray.invDirection[dim];
+      // the child on the side of the origin comes first
+      bool belowFirst =
+          ray.origin[dim] < node.split ||
+          (ray.origin[dim] == node.split && ray.direction[dim] <= 0);
+      int first = belowFirst ? nodeId + 1 : node.secondChild();
+      int second = belowFirst ? node.secondChild() : nodeId + 1;
+      // the plane is parallel to the ray (NaN), behind it or past the cell
+      if (!(tPlane <= tMax) || tPlane <= 0) {
+        nodeId = first;
+      } else if (tPlane < tMin) {
+        nodeId = second;
+      } else {
+        stack[stackSize++] = {second, tPlane, tMax};
+        nodeId = first;
+        tMax = tPlane;
+      }
+      continue;
+    }
+    int first = node.firstPrimitive;
+    int count = node.nbPrimitives();
+    for (int i = first; i < first + count; ++i) {
+      found = intersectPrimitive(i) | found;
+      if (AnyHit && found)
+        break;
+    }
+    if ((AnyHit && found) || stackSize == 0)
+      break;
+    const StackEntry &entry = stack[--stackSize];
+    nodeId = entry.nodeId;
+    tMin = entry.tMin;
+    tMax = entry.tMax;
+  }
+  RayStats::local().nodesVisited += nbVisited;
+  return found;
+}
+
+#endif
@@ -10,6 +10,8 @@
 #include <rfilter.h>
 #include <nanogui/vector.h>
 
+class Frustum;
+
 /**
  * \brief Generic camera interface
  * 
@@ -35,6 +37,33 @@ public:
      */
     virtual void sampleRay(Ray &ray, const Point2f &samplePosition) const = 0;
 
+    /**
+     * \brief Packet version of \ref sampleRay(): fills the rays of the
+     * active lanes of \a packet, from the sample positions given per lane,
+     * and updates the packet. By default the rays are sampled one by one.
+     */
+    virtual void sampleRays(RayPacket &packet,
+                            const Point2f *samplePositions) const {
+        for (int lane = 0; lane < packet.size; ++lane) {
+            if (packet.isActive(lane))
+                sampleRay(packet.rays[lane], samplePositions[lane]);
+        }
+        packet.update();
+    }
+
+    /**
+     * \brief Compute the frustum containing all the rays sampled by
+     * \ref sampleRay() in the image region [\a min, \a max], expressed in
+     * fractional pixel coordinates
+     *
+     * \return false if the camera rays do not share an origin, in which
+     * case they cannot be culled (the default)
+     */
+    virtual bool computeFrustum(const Point2f &min, const Point2f &max,
+                                Frustum &frustum) const {
+        return false;
+    }
+
     /// Return the size of the output image in pixels
     const Vector2i &getOutputSize() const { return m_outputSize; }
 
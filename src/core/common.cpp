@@ -247,6 +247,17 @@ Transform Transform::operator*(const Transform &t) const {
   return Transform(m_transform * t.m_transform, t.m_inverse * m_inverse);
 }
 
+BoundingBox3f Transform::operator*(const BoundingBox3f &box) const {
+  if (!box.min.allFinite() || !box.max.allFinite()) {
+    float inf = std::numeric_limits<float>::infinity();
+    return BoundingBox3f(Point3f(-inf, -inf, -inf), Point3f(inf, inf, inf));
+  }
+  BoundingBox3f result;
+  for (int i = 0; i < 8; ++i)
+    result.expandBy(operator*(box.getCorner(i)));
+  return result;
+}
+
 Vector3f sphericalDirection(float theta, float phi) {
   float sinTheta, cosTheta, sinPhi, cosPhi;
 
@@ -19,6 +19,7 @@
 #pragma once
 
 #include <object.h>
+#include <ray.h>
 
 class Scene;
 class Sampler;
@@ -56,8 +57,42 @@ public:
      */
     virtual Color3f Li(const Scene *scene, Sampler *sampler, const Ray &ray) const = 0;
 
+    /**
+     * \brief Packet version of \ref Li(), for the active rays of \a packet:
+     * the radiance along the ray of each lane is written to \a radiance.
+     *
+     * The lanes belong to different pixels, so the integrator does not draw
+     * from the sampler: the renderer draws \ref packetSamples2D() 2D samples
+     * per lane while the sampler is positioned on the pixel sample of the
+     * lane, and lane \c i reads them from
+     * <tt>samples2D[i * packetSamples2D()]</tt> onwards.
+     */
+    virtual void LiPacket(const Scene *scene, const RayPacket &packet,
+                          const Point2f *samples2D, Color3f *radiance) const {
+        throw RTException("Integrator::LiPacket(): not supported by %s",
+                          toString());
+    }
+
+    /// Return the number of 2D samples drawn per lane by \ref LiPacket()
+    virtual int packetSamples2D() const { return 0; }
+
+    /**
+     * \brief Return the number of rays of the packets traced by the renderer
+     * with \ref LiPacket(), or 0 to trace the rays one by one with \ref Li()
+     */
+    virtual int packetSize() const { return 0; }
+
     /**
      * \brief Return the type of object provided by this instance
      * */
     EClassType getClassType() const { return EIntegrator; }
+
+protected:
+    /// Read the property "packetSize" (0, 4, 8 or 16) of the packet-capable integrators
+    static int packetSizeProperty(const PropertyList &props) {
+        int size = props.getInteger("packetSize", 0);
+        if (size != 0 && size != 4 && size != 8 && size != 16)
+            throw RTException("Unsupported packet size %i (expected 0, 4, 8 or 16)", size);
+        return size;
+    }
 };
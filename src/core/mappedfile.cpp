@@ -0,0 +1,49 @@
+#include "mappedfile.h"
+
+#if defined(_WIN32)
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string &filename) {
+#if defined(_WIN32)
+  std::ifstream is(filename, std::ios::binary);
+  if (!is)
+    return;
+  m_buffer.assign(std::istreambuf_iterator<char>(is),
+                  std::istreambuf_iterator<char>());
+  m_data = m_buffer.data();
+  m_size = m_buffer.size();
+  m_valid = true;
+#else
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return;
+  struct stat st;
+  if (fstat(fd, &st) == 0) {
+    m_size = st.st_size;
+    if (m_size == 0) {
+      m_valid = true;
+    } else {
+      void *data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data != MAP_FAILED) {
+        m_data = static_cast<const char *>(data);
+        m_valid = true;
+      }
+    }
+  }
+  close(fd);
+#endif
+}
+
+MappedFile::~MappedFile() {
+#if !defined(_WIN32)
+  if (m_data)
+    munmap(const_cast<char *>(m_data), m_size);
+#endif
+}
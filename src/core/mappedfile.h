@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#if defined(_WIN32)
+#include <vector>
+#endif
+
+/** \class MappedFile
+ * Read-only view of the content of a file, memory-mapped where supported
+ * and read into memory otherwise. The content is not null-terminated.
+ */
+class MappedFile {
+public:
+  explicit MappedFile(const std::string &filename);
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  /// \returns false if the file could not be opened nor read
+  bool valid() const { return m_valid; }
+  const char *data() const { return m_data; }
+  size_t size() const { return m_size; }
+
+private:
+  bool m_valid = false;
+  const char *m_data = nullptr;
+  size_t m_size = 0;
+#if defined(_WIN32)
+  std::vector<char> m_buffer;
+#endif
+};
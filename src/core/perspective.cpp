@@ -7,6 +7,7 @@
 #include <Eigen/Geometry>
 
 #include "camera.h"
+#include "accelerators/frustum.h"
 #include "rfilter.h"
 #include "core/warp.h"
 
@@ -30,9 +31,11 @@ public:
     /* Horizontal field of view in degrees */
     m_fov = propList.getFloat("fov", 30.0f);
 
-    /* Near and far clipping planes in world-space units */
+    /* Near and far clipping planes in world-space units. Default: the rays
+       are not clipped beyond the near plane */
     m_nearClip = propList.getFloat("nearClip", 1e-4f);
-    m_farClip = propList.getFloat("farClip", 1e4f);
+    m_farClip = propList.getFloat("farClip",
+                                  std::numeric_limits<float>::infinity());
 
     m_rfilter = NULL;
   }
@@ -46,14 +49,20 @@ public:
      *  yProj = cot * y / z
      *  zProj = (far * (z - near)) / (z * (far-near))
      *  The cotangent factor ensures that the field of view is
-     *  mapped to the interval [-1, 1].
+     *  mapped to the interval [-1, 1]. Without far plane, zProj is the
+     *  limit (z - near) / z.
      */
-    float recip = 1.0f / (m_farClip - m_nearClip),
-          cot = 1.0f / std::tan(degToRad(m_fov / 2.0f));
+    float cot = 1.0f / std::tan(degToRad(m_fov / 2.0f));
+    float zScale = -1.0f, zOffset = -m_nearClip;
+    if (!std::isinf(m_farClip)) {
+      float recip = 1.0f / (m_farClip - m_nearClip);
+      zScale = -m_farClip * recip;
+      zOffset = -m_nearClip * m_farClip * recip;
+    }
 
     Eigen::Matrix4f perspective;
-    perspective << cot, 0, 0, 0, 0, cot, 0, 0, 0, 0, -m_farClip * recip,
-        -m_nearClip * m_farClip * recip, 0, 0, -1, 0;
+    perspective << cot, 0, 0, 0, 0, cot, 0, 0, 0, 0, zScale, zOffset, 0, 0, -1,
+        0;
 
     /**
      * Translation and scaling to shift the clip coordinates into the
@@ -82,8 +91,64 @@ public:
 
     /* Turn into a normalized ray direction */
     Vector3f d = nearP.normalized();
+    // the camera looks toward -Z: distances to the clipping planes
+    float invZ = -1.0f / d.z();
+
     ray.origin = m_cameraToWorld * Point3f(0, 0, 0);
     ray.direction = m_cameraToWorld * d;
+    ray.tMin = m_nearClip * invZ;
+    ray.tMax = m_farClip * invZ;
+    ray.update();
+  }
+
+  void sampleRays(RayPacket &packet, const Point2f *samplePositions) const {
+    // same computation as sampleRay(), for all the lanes at once
+    typedef Eigen::Matrix<float, 4, RayPacket::MaxSize> Points;
+    typedef Eigen::Matrix<float, 3, RayPacket::MaxSize> Vectors;
+    Points samples = Points::Zero();
+    for (int lane = 0; lane < packet.size; ++lane) {
+      if (!packet.isActive(lane))
+        continue;
+      samples(0, lane) = 1.f - samplePositions[lane].x() * m_invOutputSize.x();
+      samples(1, lane) = samplePositions[lane].y() * m_invOutputSize.y();
+    }
+    samples.row(3).setOnes();
+    Points nearP = m_sampleToCamera.getMatrix() * samples;
+    Vectors d = nearP.topRows<3>().array().rowwise() / nearP.row(3).array();
+    d.colwise().normalize();
+    Vectors directions = m_cameraToWorld.getMatrix().topLeftCorner<3, 3>() * d;
+    Point3f origin = m_cameraToWorld * Point3f(0, 0, 0);
+
+    for (int lane = 0; lane < packet.size; ++lane) {
+      if (!packet.isActive(lane))
+        continue;
+      Ray &ray = packet.rays[lane];
+      float invZ = -1.0f / d(2, lane);
+      ray.origin = origin;
+      ray.direction = directions.col(lane);
+      ray.tMin = m_nearClip * invZ;
+      ray.tMax = m_farClip * invZ;
+      ray.update();
+    }
+    packet.update();
+  }
+
+  bool computeFrustum(const Point2f &min, const Point2f &max,
+                      Frustum &frustum) const {
+    // the region is widened by half a pixel against the rounding errors
+    Point2f corners[4] = {Point2f(min.x() - .5f, min.y() - .5f),
+                          Point2f(max.x() + .5f, min.y() - .5f),
+                          Point2f(max.x() + .5f, max.y() + .5f),
+                          Point2f(min.x() - .5f, max.y() + .5f)};
+    Vector3f edges[4];
+    for (int i = 0; i < 4; ++i) {
+      Point3f nearP = m_sampleToCamera *
+                      Point3f(1.f - corners[i].x() * m_invOutputSize.x(),
+                              corners[i].y() * m_invOutputSize.y(), 0.0f);
+      edges[i] = m_cameraToWorld * Vector3f(nearP);
+    }
+    frustum = Frustum(m_cameraToWorld * Point3f(0, 0, 0), edges);
+    return true;
   }
 
   void addChild(Object *obj) {
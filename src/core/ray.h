@@ -5,20 +5,52 @@
 #include "vector.h"
 
 class Shape;
+struct InstanceRecord;
+struct FrustumCull;
 
 class Ray {
 public:
   Ray(const Point3f &o, const Vector3f &d, bool shadow = false)
-      : origin(o), direction(d), recursionLevel(0), shadowRay(shadow) {}
-  Ray() : recursionLevel(0), shadowRay(false) {}
+      : origin(o), direction(d), tMin(Epsilon),
+        tMax(std::numeric_limits<float>::infinity()), recursionLevel(0),
+        shadowRay(shadow), frustumCull(nullptr) {
+    update();
+  }
+  Ray(const Point3f &o, const Vector3f &d, float tMin, float tMax,
+      bool shadow = false)
+      : origin(o), direction(d), tMin(tMin), tMax(tMax), recursionLevel(0),
+        shadowRay(shadow), frustumCull(nullptr) {
+    update();
+  }
+  Ray()
+      : origin(0, 0, 0), direction(0, 0, 1), tMin(Epsilon),
+        tMax(std::numeric_limits<float>::infinity()), recursionLevel(0),
+        shadowRay(false), frustumCull(nullptr) {
+    update();
+  }
+
+  /// Updates the cached inverse direction, to call when the direction changes
+  void update() {
+    invDirection = direction.cwiseInverse();
+    for (int i = 0; i < 3; ++i)
+      sign[i] = invDirection[i] < 0.f;
+  }
 
   Point3f origin;
   Vector3f direction;
+  /// Interval of the ray parameter in which the intersections are searched
+  float tMin, tMax;
+  /// Component-wise inverse of the direction, and sign of its components
+  Vector3f invDirection;
+  int sign[3];
 
   Point3f at(float t) const { return origin + t * direction; }
 
   int recursionLevel; ///< recursion level (used as a stoping critera)
   bool shadowRay;     ///< tag for shadow rays
+  /** Shapes visible in a frustum containing the ray, set for the camera rays
+   * of an image block (see Scene::cullBlock()), or nullptr */
+  const FrustumCull *frustumCull;
 };
 
 class Hit {
@@ -31,9 +63,16 @@ public:
   Frame localFrame;
   /// pointer to the associated shape
   const Shape *shape;
+  /// Instance of the shape in the scene (transformation to world space)
+  const InstanceRecord *instance;
+  /// Index of the primitive hit within the shape (e.g. triangle of a mesh)
+  int primitiveId;
+  /// Barycentric coordinates of the hit point on this primitive
+  Point2f barycentric;
 
   Hit()
-      : t(std::numeric_limits<float>::max()), uv(0, 0), shape(nullptr) {}
+      : t(std::numeric_limits<float>::max()), uv(0, 0), shape(nullptr),
+        instance(nullptr), primitiveId(-1), barycentric(0, 0) {}
 
   bool foundIntersection() const {
     return t < std::numeric_limits<float>::max();
@@ -46,3 +85,50 @@ public:
   Vector3f toWorld(const Vector3f &d) const { return localFrame.toWorld(d); }
 
 };
+
+/** Packet of coherent rays (e.g. camera rays of neighbouring pixels) traced
+ * together: the boxes of the BVH nodes are tested against all the rays at
+ * once with SIMD instructions, and the packet enters a node if any of its
+ * active rays hits it. Packets of 4, 8 and 16 rays are supported.
+ *
+ * The rays are stored as Ray for the per-ray code (primitive tests,
+ * shading), and copied in SoA layout by update() for the box tests.
+ */
+class RayPacket {
+public:
+  static constexpr int MaxSize = 16;
+
+  explicit RayPacket(int size) : size(size), activeMask(0) {}
+
+  /// \returns true if the ray of \a lane is traced
+  bool isActive(int lane) const { return (activeMask >> lane) & 1; }
+
+  /** Copies the rays to the SoA layout, to call when they changed. The
+   * inactive lanes get an empty interval, so that they never hit a box. */
+  void update() {
+    for (int lane = 0; lane < size; ++lane) {
+      const Ray &ray = rays[lane];
+      bool active = isActive(lane);
+      for (int dim = 0; dim < 3; ++dim) {
+        origin[dim][lane] = active ? ray.origin[dim] : 0.f;
+        invDirection[dim][lane] = active ? ray.invDirection[dim] : 0.f;
+        sign[dim][lane] = active ? ray.sign[dim] : 0.f;
+      }
+      tMin[lane] = active ? ray.tMin : std::numeric_limits<float>::infinity();
+      tMax[lane] = active ? ray.tMax : -std::numeric_limits<float>::infinity();
+    }
+  }
+
+  /// Number of lanes of the packet (4, 8 or 16)
+  int size;
+  /// Bit i is set if the ray of lane i is traced
+  uint32_t activeMask;
+  Ray rays[MaxSize];
+
+  /// SoA copies of the rays, sign is 1 for the negative directions
+  alignas(64) float origin[3][MaxSize];
+  alignas(64) float invDirection[3][MaxSize];
+  alignas(64) float sign[3][MaxSize];
+  alignas(64) float tMin[MaxSize];
+  alignas(64) float tMax[MaxSize];
+};
@@ -1,17 +1,34 @@
 #include "scene.h"
 #include "lights/areaLight.h"
+#include "shapes/instance.h"
 #include "shapes/mesh.h"
 #include "shapes/sphere.h"
+#include "stats.h"
 
 #include <Eigen/Geometry>
+#include <memory>
+
+/* Maximal number of top-level subtrees kept by the frustum culling: each
+ * camera ray of the block tests the box of each of them */
+static const int MaxCulledRoots = 16;
 
 Scene::Scene(const PropertyList &props) {
   m_backgroundColor = props.getColor("background", Color3f(0.0));
   m_envMap = nullptr;
+  m_bakeMeshes = props.getBoolean("bakeMeshes", false);
+  m_bakedBVHParams = Mesh::bvhParams(props);
+  m_frustumCulling = props.getBoolean("frustumCulling", true);
 }
 
 void Scene::clear() {
   m_shapeList.clear();
+  m_meshesById.clear();
+  m_unresolvedInstances.clear();
+  m_boundedInstances.clear();
+  m_unboundedInstances.clear();
+  if (m_bakedMesh)
+    delete m_bakedMesh;
+  m_bakedMesh = nullptr;
   m_lightList.clear();
   if (m_camera)
     delete m_camera;
@@ -43,48 +60,319 @@ void Scene::activate() {
     addChild(al->shape());
   }
 
+  // the instances declared before their mesh
+  for (Instance *instance : m_unresolvedInstances) {
+    auto it = m_meshesById.find(instance->meshId());
+    if (it == m_meshesById.end())
+      throw RTException("Instance: no mesh with the id \"%s\" was declared "
+                        "in the scene",
+                        instance->meshId());
+    it->second->prepareAccelerator();
+    instance->setMesh(it->second);
+  }
+  m_unresolvedInstances.clear();
+
+  updateBVH();
+
   cout << endl;
   cout << "Configuration: " << toString() << endl;
   cout << endl;
 }
 
+void Scene::updateBVH() {
+  // the hierarchy has one primitive per shape: it is simply rebuilt
+  m_boundedInstances.clear();
+  m_unboundedInstances.clear();
+  if (m_bakedMesh)
+    delete m_bakedMesh;
+  m_bakedMesh = nullptr;
+  std::vector<BoundingBox3f> shapeBounds;
+  std::vector<const Mesh *> bakedMeshes;
+  for (Shape *shape : m_shapeList) {
+    const Mesh *mesh =
+        m_bakeMeshes ? dynamic_cast<const Mesh *>(shape) : nullptr;
+    if (mesh) {
+      bakedMeshes.push_back(mesh);
+      continue;
+    }
+    BoundingBox3f box = shape->transformation() * shape->getBoundingBox();
+    if (box.min.allFinite() && box.max.allFinite()) {
+      m_boundedInstances.push_back(InstanceRecord(shape));
+      shapeBounds.push_back(box);
+    } else {
+      m_unboundedInstances.push_back(InstanceRecord(shape));
+    }
+  }
+  if (!bakedMeshes.empty()) {
+    cout << "Baking " << bakedMeshes.size() << " meshes in world space"
+         << endl;
+    m_bakedMesh = new Mesh(bakedMeshes, m_bakedBVHParams);
+    m_boundedInstances.push_back(InstanceRecord(m_bakedMesh));
+    shapeBounds.push_back(m_bakedMesh->getBoundingBox());
+  }
+  BVH::BuildParams params;
+  params.targetCellSize = 2;
+  m_BVH.build(shapeBounds, params);
+  // store the instances in the leaf order of the hierarchy
+  std::vector<InstanceRecord> instances;
+  instances.reserve(m_boundedInstances.size());
+  for (int shapeId : m_BVH.primitiveIds())
+    instances.push_back(m_boundedInstances[shapeId]);
+  m_boundedInstances.swap(instances);
+}
+
 Color3f Scene::backgroundColor(const Vector3f &direction) const {
   if (m_envMap)
     return m_envMap->intensity(direction);
   return m_backgroundColor;
 }
 
+bool Scene::cullBlock(const Point2f &min, const Point2f &max,
+                      FrustumCull &cull) const {
+  Frustum frustum;
+  if (!m_frustumCulling || !m_camera->computeFrustum(min, max, frustum))
+    return false;
+  return m_BVH.cull(frustum, MaxCulledRoots, cull.roots);
+}
+
 /** Search for the nearest intersection between the ray and the object list */
 void Scene::intersect(const Ray &ray, Hit &hit) const {
-  for (uint32_t i = 0; i < m_shapeList.size(); ++i) {
-    // apply transformation
-    Transform invTransform = m_shapeList[i]->transformation().inverse();
-    Ray local_ray = invTransform * ray;
-    float old_t = hit.t;
-    if (hit.foundIntersection()) {
-      // If previous intersection found, transform intersection point
-      Point3f x = ray.at(hit.t);
-      hit.t = (invTransform * x - local_ray.origin).norm();
+  auto intersectInstance = [&](int i) {
+    return intersectShape(m_boundedInstances[i], ray, hit);
+  };
+  if (ray.frustumCull)
+    m_BVH.intersectCulled(ray, hit, ray.frustumCull->roots,
+                          intersectInstance);
+  else
+    m_BVH.intersect(ray, hit, intersectInstance);
+  for (const InstanceRecord &instance : m_unboundedInstances)
+    intersectShape(instance, ray, hit);
+  // the BSDF and the light of the faces of the merged mesh are the ones of
+  // their source mesh
+  if (m_bakedMesh && hit.shape == m_bakedMesh)
+    hit.shape = m_bakedMesh->sourceMesh(hit.primitiveId);
+
+  RayStats &stats = RayStats::local();
+  ++stats.closestHitRays;
+  if (hit.shape)
+    ++stats.hits;
+
+  // Only the closest intersection is shaded
+  if (hit.instance && !ray.shadowRay)
+    computeSurfaceInteraction(ray, hit);
+}
+
+void Scene::intersect(const RayPacket &packet, Hit *hits) const {
+  auto intersectInstance = [&](int i, uint32_t mask) {
+    intersectShape(m_boundedInstances[i], packet, mask, hits);
+  };
+  // the rays of a packet are sampled in the same image block
+  const FrustumCull *cull = nullptr;
+  for (int lane = 0; lane < packet.size && !cull; ++lane) {
+    if (packet.isActive(lane))
+      cull = packet.rays[lane].frustumCull;
+  }
+  if (cull)
+    m_BVH.intersectPacketCulled(packet, packet.activeMask, hits, cull->roots,
+                                intersectInstance);
+  else
+    m_BVH.intersectPacket(packet, packet.activeMask, hits,
+                          intersectInstance);
+  RayStats &stats = RayStats::local();
+  for (int lane = 0; lane < packet.size; ++lane) {
+    if (!packet.isActive(lane))
+      continue;
+    const Ray &ray = packet.rays[lane];
+    Hit &hit = hits[lane];
+    for (const InstanceRecord &instance : m_unboundedInstances)
+      intersectShape(instance, ray, hit);
+    if (m_bakedMesh && hit.shape == m_bakedMesh)
+      hit.shape = m_bakedMesh->sourceMesh(hit.primitiveId);
+
+    ++stats.closestHitRays;
+    if (hit.shape)
+      ++stats.hits;
+    if (hit.instance && !ray.shadowRay)
+      computeSurfaceInteraction(ray, hit);
+  }
+}
+
+void Scene::computeSurfaceInteraction(const Ray &ray, Hit &hit) const {
+  const InstanceRecord &instance = *hit.instance;
+  if (instance.kind == InstanceRecord::EIdentity) {
+    instance.shape->computeSurfaceInteraction(ray, hit);
+  } else {
+    instance.shape->computeSurfaceInteraction(instance.toObject(ray), hit);
+    hit.localFrame = instance.toWorld(hit.localFrame);
+  }
+}
+
+bool Scene::intersectShape(const InstanceRecord &instance, const Ray &ray,
+                           Hit &hit) const {
+  float t = hit.t;
+  if (instance.kind == InstanceRecord::EIdentity)
+    instance.shape->intersect(ray, hit);
+  else
+    instance.shape->intersect(instance.toObject(ray), hit);
+
+  if (hit.t < t) {
+    // we found a new closest intersection point for this object, record it:
+    hit.shape = instance.shape;
+    hit.instance = &instance;
+    return true;
+  }
+  return false;
+}
+
+void Scene::intersectShape(const InstanceRecord &instance,
+                           const RayPacket &packet, uint32_t mask,
+                           Hit *hits) const {
+  float t[RayPacket::MaxSize];
+  for (int lane = 0; lane < packet.size; ++lane)
+    t[lane] = hits[lane].t;
+  if (instance.kind == InstanceRecord::EIdentity) {
+    instance.shape->intersectPacket(packet, mask, hits);
+  } else {
+    RayPacket local(packet.size);
+    local.activeMask = mask;
+    for (int lane = 0; lane < packet.size; ++lane) {
+      if ((mask >> lane) & 1)
+        local.rays[lane] = instance.toObject(packet.rays[lane]);
     }
-    Hit h;
-    h.t = hit.t;
-    m_shapeList[i]->intersect(local_ray, h);
-
-    if (h.t < hit.t) {
-      // we found a new closest intersection point for this object, record it:
-      hit.shape = m_shapeList[i];
-      Point3f x = local_ray.at(h.t);
-      hit.localFrame = Frame(
-          (m_shapeList[i]->transformation() * h.localFrame.s).normalized(),
-          (m_shapeList[i]->transformation() * h.localFrame.t).normalized(),
-          Normal3f((m_shapeList[i]->transformation() * h.localFrame.n)
-                       .normalized()));
-      hit.t = (m_shapeList[i]->transformation() * x - ray.origin).norm();
-      hit.uv = h.uv;
-    } else {
-      hit.t = old_t;
+    local.update();
+    instance.shape->intersectPacket(local, mask, hits);
+  }
+
+  for (int lane = 0; lane < packet.size; ++lane) {
+    if (((mask >> lane) & 1) && hits[lane].t < t[lane]) {
+      hits[lane].shape = instance.shape;
+      hits[lane].instance = &instance;
+    }
+  }
+}
+
+bool Scene::occluded(const Ray &ray, float tMax) const {
+  RayStats &stats = RayStats::local();
+  ++stats.shadowRays;
+  // clip the ray to the distance of interest, e.g. to a light
+  tMax = std::min(tMax, ray.tMax);
+  if (m_BVH.occluded(ray, tMax, [&](int i) {
+        return occludedByShape(m_boundedInstances[i], ray, tMax);
+      })) {
+    ++stats.hits;
+    return true;
+  }
+  for (const InstanceRecord &instance : m_unboundedInstances) {
+    if (occludedByShape(instance, ray, tMax)) {
+      ++stats.hits;
+      return true;
     }
   }
+  return false;
+}
+
+bool Scene::occludedByShape(const InstanceRecord &instance, const Ray &ray,
+                            float tMax) const {
+  // the ray parameter is the same in object space
+  if (instance.kind == InstanceRecord::EIdentity)
+    return instance.shape->occluded(ray, tMax);
+  return instance.shape->occluded(instance.toObject(ray), tMax);
+}
+
+void Scene::occluded(const Ray *rays, int count, bool *isOccluded) const {
+  std::fill(isOccluded, isOccluded + count, false);
+  std::vector<int> ids(count);
+  for (int i = 0; i < count; ++i)
+    ids[i] = i;
+  StreamBuffers buffers;
+  buffers.remaining.resize(count);
+  m_BVH.occludedStream(
+      rays, ids.data(), count, isOccluded,
+      [&](int first, int nbShapes, const int *leafIds, int nbIds) {
+        int *remaining = buffers.remaining.data();
+        std::copy(leafIds, leafIds + nbIds, remaining);
+        auto occluded = [&](int id) { return isOccluded[id]; };
+        for (int i = first; i < first + nbShapes && nbIds > 0; ++i) {
+          occludedByShape(m_boundedInstances[i], rays, remaining, nbIds,
+                          isOccluded, buffers);
+          // the next shapes of the leaf only test the rays still visible
+          nbIds = std::remove_if(remaining, remaining + nbIds, occluded) -
+                  remaining;
+        }
+      });
+
+  RayStats &stats = RayStats::local();
+  stats.shadowRays += count;
+  for (int i = 0; i < count; ++i) {
+    for (size_t j = 0; j < m_unboundedInstances.size() && !isOccluded[i]; ++j)
+      isOccluded[i] =
+          occludedByShape(m_unboundedInstances[j], rays[i], rays[i].tMax);
+    stats.hits += isOccluded[i];
+  }
+}
+
+void Scene::occludedByShape(const InstanceRecord &instance, const Ray *rays,
+                            const int *ids, int count, bool *isOccluded,
+                            StreamBuffers &buffers) const {
+  if (instance.kind == InstanceRecord::EIdentity) {
+    instance.shape->occludedStream(rays, ids, count, isOccluded);
+    return;
+  }
+  // the shape gets the rays in its object space, in a stream of their own,
+  // whose buffers are allocated by the first transformed instance
+  if (buffers.localRays.empty()) {
+    size_t size = buffers.remaining.size();
+    buffers.localRays.resize(size);
+    buffers.localIds.resize(size);
+    for (size_t k = 0; k < size; ++k)
+      buffers.localIds[k] = k;
+    buffers.localOccluded.reset(new bool[size]);
+  }
+  Ray *localRays = buffers.localRays.data();
+  bool *localOccluded = buffers.localOccluded.get();
+  for (int k = 0; k < count; ++k) {
+    localRays[k] = instance.toObject(rays[ids[k]]);
+    localOccluded[k] = false;
+  }
+  instance.shape->occludedStream(localRays, buffers.localIds.data(), count,
+                                 localOccluded);
+  for (int k = 0; k < count; ++k) {
+    if (localOccluded[k])
+      isOccluded[ids[k]] = true;
+  }
+}
+
+InstanceRecord::InstanceRecord(const Shape *shape) : shape(shape) {
+  const Transform &trafo = shape->transformation();
+  worldToObject = trafo.getInverseMatrix().topRows<3>();
+  objectToWorld = trafo.getMatrix().topLeftCorner<3, 3>();
+  normalMatrix = worldToObject.leftCols<3>().transpose();
+  if (!objectToWorld.isIdentity(1e-6f))
+    kind = EAffine;
+  else if (!worldToObject.col(3).isZero(1e-6f))
+    kind = ETranslation;
+  else
+    kind = EIdentity;
+}
+
+Ray InstanceRecord::toObject(const Ray &ray) const {
+  Ray r(ray);
+  if (kind == ETranslation) {
+    r.origin += worldToObject.col(3);
+  } else if (kind == EAffine) {
+    r.origin = worldToObject.leftCols<3>() * ray.origin + worldToObject.col(3);
+    r.direction = worldToObject.leftCols<3>() * ray.direction;
+    r.update();
+  }
+  return r;
+}
+
+Frame InstanceRecord::toWorld(const Frame &frame) const {
+  if (kind != EAffine)
+    return frame;
+  return Frame((objectToWorld * frame.s).normalized(),
+               (objectToWorld * frame.t).normalized(),
+               Normal3f((normalMatrix * frame.n).normalized()));
 }
 
 void Scene::addChild(Object *obj) {
@@ -92,6 +380,24 @@ void Scene::addChild(Object *obj) {
   case EShape: {
     Shape *shape = static_cast<Shape *>(obj);
     m_shapeList.push_back(shape);
+    if (Mesh *mesh = dynamic_cast<Mesh *>(shape)) {
+      // the baked meshes are traced through the BVH of the baked mesh
+      if (!m_bakeMeshes)
+        mesh->prepareAccelerator();
+      if (!mesh->id().empty() &&
+          !m_meshesById.emplace(mesh->id(), mesh).second)
+        throw RTException("Scene: two meshes have the id \"%s\"",
+                          mesh->id());
+    } else if (Instance *instance = dynamic_cast<Instance *>(shape)) {
+      if (!instance->meshId().empty()) {
+        auto it = m_meshesById.find(instance->meshId());
+        if (it != m_meshesById.end()) {
+          it->second->prepareAccelerator();
+          instance->setMesh(it->second);
+        } else
+          m_unresolvedInstances.push_back(instance);
+      }
+    }
   } break;
 
   case ELight: {
@@ -1,16 +1,61 @@
 #pragma once
 
+#include "accelerators/bvh.h"
 #include "camera.h"
 #include "integrator.h"
 #include "light.h"
 #include "sampler.h"
 #include "shape.h"
 
+#include <map>
+#include <memory>
+
 class AreaLight;
+class Mesh;
+class Instance;
 
 typedef std::vector<Shape *> ShapeList;
 typedef std::vector<Light *> LightList;
 
+/** Transformations of a shape precomputed once at activation, so that
+ * intersection queries do not invert matrices nor renormalize rays.
+ *
+ * Rays are moved to object space with worldToObject without normalizing their
+ * direction: the ray parameter t is then the same in both spaces.
+ */
+struct InstanceRecord {
+  enum EKind {
+    EIdentity = 0, ///< object and world space coincide
+    ETranslation,  ///< pure translation, only the ray origin is moved
+    EAffine        ///< general affine transformation
+  };
+
+  InstanceRecord(const Shape *shape);
+
+  /// Transform a world space ray to the object space of the shape
+  Ray toObject(const Ray &ray) const;
+
+  /// Transform a frame computed in object space to world space
+  Frame toWorld(const Frame &frame) const;
+
+  const Shape *shape;
+  EKind kind;
+  /// Affine world to object matrix
+  Eigen::Matrix<float, 3, 4> worldToObject;
+  /// Linear part of the object to world matrix (for tangent vectors)
+  Eigen::Matrix3f objectToWorld;
+  /// Inverse transpose of objectToWorld (for normals)
+  Eigen::Matrix3f normalMatrix;
+};
+
+/** Subtrees of the top-level BVH which may contain shapes visible through an
+ * image block, computed once per block by Scene::cullBlock(). The camera
+ * rays of the block point to it (Ray::frustumCull), and start their
+ * traversal from these subtrees rather than from the root. */
+struct FrustumCull {
+  std::vector<int> roots;
+};
+
 class Scene : public Object {
 public:
   Scene(const PropertyList &props);
@@ -37,9 +82,50 @@ public:
   /// \return the background color
   Color3f backgroundColor(const Vector3f &direction = Vector3f::UnitZ()) const;
 
-  /// Search the nearest intersection between the ray and the shape list
+  /** Search the nearest intersection between the ray and the shape list.
+   * The shading data of the nearest hit are then computed once by
+   * computeSurfaceInteraction(), unless the ray is a shadow ray. */
   void intersect(const Ray &ray, Hit &hit) const;
 
+  /** Packet version of intersect(), for the active rays of \a packet, whose
+   * nearest hits are written to \a hits (one per lane). The top-level BVH
+   * and the BVHs of the meshes are traversed by the whole packet. */
+  void intersect(const RayPacket &packet, Hit *hits) const;
+
+  /** Compute the world space shading frame and texture coordinates of a hit
+   * recorded by the traversal (shape, primitive id and barycentrics) */
+  void computeSurfaceInteraction(const Ray &ray, Hit &hit) const;
+
+  /** Culls the top-level BVH against the part of the camera frustum seen
+   * through the image region [\a min, \a max] (in fractional pixel
+   * coordinates), for the camera rays sampled in this region. \returns
+   * false if the region cannot be culled: the camera has no frustum, or the
+   * scene property <boolean name="frustumCulling" value="false"/> was set. */
+  bool cullBlock(const Point2f &min, const Point2f &max,
+                 FrustumCull &cull) const;
+
+  /** Builds the top-level BVH over the world space bounds of the shapes, to
+   * call again when shapes moved or were deformed (see Mesh::setPositions).
+   * With the scene property <boolean name="bakeMeshes" value="true"/>, the
+   * meshes are first merged in world space into a single mesh with its own
+   * BVH (built with the "bvh..." properties of the scene, see
+   * Mesh::bvhParams()), so that their rays are not transformed and traverse
+   * a single hierarchy. Their own BVHs are then not built, unless an
+   * instance uses them. */
+  void updateBVH();
+
+  /** \returns true if any shape is hit by the ray before \a tMax. Much
+   * cheaper than intersect() for visibility tests: the traversal stops at the
+   * first hit and no shading data are computed. */
+  bool occluded(const Ray &ray, float tMax) const;
+
+  /** Stream version of occluded(), for a large batch of incoherent rays
+   * (e.g. all the shadow rays of several pixels), each clipped to its own
+   * tMax: \a isOccluded[i] is set to true if rays[i] is occluded. The
+   * rays are traversed together through the top-level BVH and the BVHs of
+   * the meshes, see BVH::occludedStream(). */
+  void occluded(const Ray *rays, int count, bool *isOccluded) const;
+
   /**
    * \brief Inherited from \ref NoriObject::activate()
    *
@@ -48,7 +134,9 @@ public:
    */
   void activate();
 
-  /// Register a child object (e.g. a material) with the shape
+  /** Register a child object (e.g. a material) with the shape. The meshes
+   * with an id are recorded, and the instances referencing a recorded mesh
+   * are given it; the other instances are resolved by activate(). */
   virtual void addChild(Object *child);
 
   /// \brief Return the type of object provided by this instance
@@ -61,11 +149,53 @@ public:
   std::string toString() const;
 
 private:
+  /// Intersects the ray with a single shape instance
+  bool intersectShape(const InstanceRecord &instance, const Ray &ray,
+                      Hit &hit) const;
+  /// Intersects the rays of \a packet selected by \a mask with an instance
+  void intersectShape(const InstanceRecord &instance, const RayPacket &packet,
+                      uint32_t mask, Hit *hits) const;
+  /// Visibility test against a single shape instance
+  bool occludedByShape(const InstanceRecord &instance, const Ray &ray,
+                       float tMax) const;
+  /** Buffers of a stream visibility test, allocated once for the whole
+   * stream: the rays of the current leaf still visible, and the rays in
+   * object space of the transformed instances with their ids and results */
+  struct StreamBuffers {
+    std::vector<int> remaining;
+    std::vector<Ray> localRays;
+    std::vector<int> localIds;
+    std::unique_ptr<bool[]> localOccluded;
+  };
+  /// Visibility test of the rays rays[ids[k]], k < count, against an instance
+  void occludedByShape(const InstanceRecord &instance, const Ray *rays,
+                       const int *ids, int count, bool *isOccluded,
+                       StreamBuffers &buffers) const;
+
   Integrator *m_integrator = nullptr;
   Sampler *m_sampler = nullptr;
   Camera *m_camera = nullptr;
 
   ShapeList m_shapeList;
+  /// Meshes of the scene by id, referenced by the instances
+  std::map<std::string, Mesh *> m_meshesById;
+  /// Instances whose mesh was not declared yet when they were added
+  std::vector<Instance *> m_unresolvedInstances;
+
+  /** Top-level acceleration structure over the world-space bounding boxes of
+   * the shapes of m_boundedInstances. Meshes keep their own BVH as the bottom
+   * level. */
+  BVH m_BVH;
+  std::vector<InstanceRecord> m_boundedInstances;
+  /// Shapes with infinite extent (e.g. infinite planes), tested linearly
+  std::vector<InstanceRecord> m_unboundedInstances;
+
+  /// Merge of the meshes of the scene (see updateBVH()), or nullptr
+  Mesh *m_bakedMesh = nullptr;
+  bool m_bakeMeshes;
+  BVH::BuildParams m_bakedBVHParams;
+
+  bool m_frustumCulling;
 
   LightList m_lightList;
   std::vector<AreaLight *> m_areaLightList;
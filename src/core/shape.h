@@ -1,5 +1,6 @@
 #pragma once
 
+#include "accelerators/bbox.h"
 #include "bsdf.h"
 #include "common.h"
 #include "object.h"
@@ -19,12 +20,57 @@ public:
   virtual void activate();
 
   /** Search the nearest intersection between the ray and the shape.
+   * Only the distance \a hit.t, and if needed the primitive id and the
+   * barycentric coordinates, are recorded: the shading data are computed
+   * later for the closest hit by computeSurfaceInteraction().
    * It must be implemented in the derived class. */
   virtual bool intersect(const Ray &ray, Hit &hit) const {
     throw RTException(
         "Shape::intersect must be implemented in the derived class");
   }
 
+  /** Packet version of intersect(), for the rays of \a packet selected by
+   * \a mask, whose nearest hits are in \a hits (one per lane). By default,
+   * the rays are intersected one by one. */
+  virtual void intersectPacket(const RayPacket &packet, uint32_t mask,
+                               Hit *hits) const {
+    for (int lane = 0; lane < packet.size; ++lane) {
+      if ((mask >> lane) & 1)
+        intersect(packet.rays[lane], hits[lane]);
+    }
+  }
+
+  /** Compute the shading frame and the texture coordinates, in object space,
+   * of a hit found by intersect() along the (object space) ray.
+   * It must be implemented in the derived class. */
+  virtual void computeSurfaceInteraction(const Ray &ray, Hit &hit) const {
+    throw RTException("Shape::computeSurfaceInteraction must be implemented "
+                      "in the derived class");
+  }
+
+  /** \returns true if the ray hits the shape at a distance lower than
+   * \a tMax. Unlike intersect(), it can stop at the first hit found and
+   * does not compute the shading data. */
+  virtual bool occluded(const Ray &ray, float tMax) const {
+    Ray shadowRay(ray);
+    shadowRay.shadowRay = true;
+    Hit hit;
+    hit.t = tMax;
+    return intersect(shadowRay, hit);
+  }
+
+  /** Stream version of occluded(), for the rays rays[ids[k]], k < \a count,
+   * each clipped to its own tMax: sets \a isOccluded[id] for the occluded
+   * rays. By default, the rays are tested one by one. */
+  virtual void occludedStream(const Ray *rays, const int *ids, int count,
+                              bool *isOccluded) const {
+    for (int k = 0; k < count; ++k) {
+      const Ray &ray = rays[ids[k]];
+      if (occluded(ray, ray.tMax))
+        isOccluded[ids[k]] = true;
+    }
+  }
+
   /** Return the axis-aligned bounding box of the geometry.
    * It must be implemented in the derived class. */
   virtual const BoundingBox3f &getBoundingBox() const {
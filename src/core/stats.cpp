@@ -0,0 +1,85 @@
+#include "stats.h"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+/// Counters of the live threads, and total of the threads which exited
+struct StatsRegistry {
+  std::mutex mutex;
+  std::vector<RayStats *> threads;
+  RayStats exited;
+};
+
+StatsRegistry &registry() {
+  static StatsRegistry registry;
+  return registry;
+}
+
+/// Counters of a thread, registered in the registry during its lifetime
+struct ThreadStats {
+  RayStats stats;
+
+  ThreadStats() {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    registry().threads.push_back(&stats);
+  }
+
+  ~ThreadStats() {
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    std::vector<RayStats *> &threads = registry().threads;
+    threads.erase(std::find(threads.begin(), threads.end(), &stats));
+    registry().exited += stats;
+  }
+};
+
+} // namespace
+
+RayStats &RayStats::operator+=(const RayStats &stats) {
+  primaryRays += stats.primaryRays;
+  closestHitRays += stats.closestHitRays;
+  shadowRays += stats.shadowRays;
+  nodesVisited += stats.nodesVisited;
+  trianglesTested += stats.trianglesTested;
+  hits += stats.hits;
+  return *this;
+}
+
+RayStats &RayStats::local() {
+  static thread_local ThreadStats threadStats;
+  return threadStats.stats;
+}
+
+void RayStats::reset() {
+  std::lock_guard<std::mutex> lock(registry().mutex);
+  for (RayStats *stats : registry().threads)
+    *stats = RayStats();
+  registry().exited = RayStats();
+}
+
+RayStats RayStats::collect() {
+  std::lock_guard<std::mutex> lock(registry().mutex);
+  RayStats total = registry().exited;
+  for (const RayStats *stats : registry().threads)
+    total += *stats;
+  return total;
+}
+
+std::string RayStats::toString(double elapsed) const {
+  double rays = std::max(totalRays(), 1l);
+  double seconds = std::max(elapsed, 1.) * 1e-3;
+  return tfm::format("Ray statistics:\n"
+                     "  primary rays      : %i\n"
+                     "  secondary rays    : %i\n"
+                     "  shadow rays       : %i\n"
+                     "  hits              : %i (%.1f%%)\n"
+                     "  nodes visited     : %i (%.1f per ray)\n"
+                     "  triangles tested  : %i (%.1f per ray)\n"
+                     "  throughput        : %.2f Mrays/s",
+                     primaryRays, secondaryRays(), shadowRays, hits,
+                     100. * hits / rays, nodesVisited, nodesVisited / rays,
+                     trianglesTested, trianglesTested / rays,
+                     totalRays() / seconds * 1e-6);
+}
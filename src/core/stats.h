@@ -0,0 +1,45 @@
+#pragma once
+
+#include "common.h"
+
+/** \struct RayStats
+ * Counters of the rays traced and of the work of their traversals.
+ *
+ * Each thread increments its own counters, given by local(), without atomic
+ * operations nor sharing of cache lines with the other threads. collect()
+ * sums the counters of all the threads: it must be called once the rays are
+ * traced, e.g. at the end of Viewer::render(), as must reset().
+ */
+struct RayStats {
+  /// Rays generated by the camera (counted by the renderer)
+  long int primaryRays = 0;
+  /// Rays traced with Scene::intersect(), including the primary rays
+  long int closestHitRays = 0;
+  /// Rays traced with Scene::occluded()
+  long int shadowRays = 0;
+  /// Nodes of the BVHs and kd-trees visited by the traversals
+  long int nodesVisited = 0;
+  /// Ray/triangle tests of the meshes (a SIMD pack counts for its size)
+  long int trianglesTested = 0;
+  /// Closest-hit rays which hit a shape, and occluded shadow rays
+  long int hits = 0;
+
+  /// \returns the rays traced after the primary ones (reflections, AO, ...)
+  long int secondaryRays() const { return closestHitRays - primaryRays; }
+  long int totalRays() const { return closestHitRays + shadowRays; }
+
+  RayStats &operator+=(const RayStats &stats);
+
+  /// \returns the counters of the calling thread
+  static RayStats &local();
+
+  /// Sets the counters of all the threads to zero
+  static void reset();
+
+  /// \returns the sum of the counters of all the threads
+  static RayStats collect();
+
+  /** \returns a human-readable summary, with the throughput for the given
+   * rendering time in milliseconds */
+  std::string toString(double elapsed) const;
+};
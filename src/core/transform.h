@@ -21,6 +21,7 @@
 #include "common.h"
 #include "vector.h"
 #include "ray.h"
+#include "accelerators/bbox.h"
 
 /**
  * \brief Homogeneous coordinate transformation
@@ -84,6 +85,14 @@ public:
                    operator*(r.direction).normalized());
     }
 
+    /**
+     * \brief Apply the homogeneous transformation to an axis-aligned bounding
+     * box, returns the bounding box of its 8 transformed corners.
+     *
+     * Unbounded boxes (e.g. infinite planes) are mapped to the whole space.
+     */
+    BoundingBox3f operator*(const BoundingBox3f &box) const;
+
     /// Return a string representation
     std::string toString() const;
 private:
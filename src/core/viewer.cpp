@@ -4,6 +4,7 @@
 #include "parser.h"
 #include "sampler.h"
 #include "shapes/mesh.h"
+#include "stats.h"
 #include "timer.h"
 
 #include <filesystem/resolver.h>
@@ -222,7 +223,14 @@ void Viewer::loadScene(const std::string &filename) {
 
     getFileResolver()->prepend(path.parent_path());
 
-    ::Object *root = loadFromXML(filename);
+    ::Object *root;
+    {
+      // the acceleration structures are built in parallel while loading
+      tbb::task_scheduler_init init(m_threadCount < 0
+                                        ? tbb::task_scheduler_init::automatic
+                                        : m_threadCount);
+      root = loadFromXML(filename);
+    }
     if (root->getClassType() == ::Object::EScene) {
       if (m_scene)
         delete m_scene;
@@ -276,6 +284,76 @@ void Viewer::loadImage(const filesystem::path &filename) {
       m_resultImage->getSize().y()));
 }
 
+/* Packet version of Viewer::renderBlock(): the pixels are traced by tiles of
+ * packetSize pixels (2x2, 4x2 or 4x4), with one packet per sample index. The
+ * sample positions and the 2D samples of the integrator are drawn pixel by
+ * pixel in the same order, while the sampler is positioned on each pixel
+ * sample, before the packets of the tile rows are traced. */
+static void renderBlockPackets(Scene *scene, Sampler *sampler,
+                               ImageBlock &block, int packetSize,
+                               const FrustumCull *cull) {
+  const Camera *camera = scene->camera();
+  const Integrator *integrator = scene->integrator();
+  Vector2i offset = block.getOffset();
+  Vector2i size = block.getSize();
+  int tileWidth = packetSize == 4 ? 2 : 4;
+  int tileHeight = packetSize / tileWidth;
+  int sampleCount = sampler->getSampleCount();
+  int samples2D = integrator->packetSamples2D();
+
+  /* Samples of the rows [y, y + tileHeight) of the block: for each pixel
+     sample, its position followed by the samples2D samples of the integrator */
+  int stride = 1 + samples2D;
+  std::vector<Point2f> samples(tileHeight * size.x() * sampleCount * stride);
+  std::vector<Point2f> laneSamples(packetSize * samples2D);
+  RayPacket packet(packetSize);
+  Point2f positions[RayPacket::MaxSize];
+  Color3f radiance[RayPacket::MaxSize];
+  for (int y = 0; y < size.y(); y += tileHeight) {
+    int rows = std::min(tileHeight, size.y() - y);
+    for (int j = 0; j < rows; ++j) {
+      for (int x = 0; x < size.x(); ++x) {
+        Point2f *pixelSamples =
+            &samples[(j * size.x() + x) * sampleCount * stride];
+        Point2f pixel(float(x + offset.x()), float(y + j + offset.y()));
+        sampler->generate();
+        for (int i = 0; i < sampleCount; ++i, pixelSamples += stride) {
+          pixelSamples[0] = sampleCount == 1 ? pixel + Point2f(0.5f, 0.5f)
+                                             : pixel + sampler->next2D();
+          for (int k = 1; k <= samples2D; ++k)
+            pixelSamples[k] = sampler->next2D();
+          sampler->advance();
+        }
+      }
+    }
+
+    for (int x = 0; x < size.x(); x += tileWidth) {
+      for (int i = 0; i < sampleCount; ++i) {
+        packet.activeMask = 0;
+        for (int lane = 0; lane < packetSize; ++lane) {
+          int tx = x + lane % tileWidth, ty = lane / tileWidth;
+          if (tx >= size.x() || ty >= rows)
+            continue;
+          packet.activeMask |= 1u << lane;
+          const Point2f *pixelSample =
+              &samples[((ty * size.x() + tx) * sampleCount + i) * stride];
+          positions[lane] = pixelSample[0];
+          std::copy(pixelSample + 1, pixelSample + stride,
+                    laneSamples.begin() + lane * samples2D);
+        }
+        camera->sampleRays(packet, positions);
+        for (int lane = 0; lane < packetSize; ++lane)
+          packet.rays[lane].frustumCull = cull;
+        integrator->LiPacket(scene, packet, laneSamples.data(), radiance);
+        for (int lane = 0; lane < packetSize; ++lane) {
+          if (packet.isActive(lane))
+            block.put(positions[lane], radiance[lane]);
+        }
+      }
+    }
+  }
+}
+
 void Viewer::renderBlock(Scene *scene, Sampler *sampler, ImageBlock &block) {
   const Camera *camera = scene->camera();
 
@@ -287,6 +365,22 @@ void Viewer::renderBlock(Scene *scene, Sampler *sampler, ImageBlock &block) {
   Vector2i offset = block.getOffset();
   Vector2i size = block.getSize();
 
+  /* Cull the shapes outside of the frustum of the block once for all its
+     camera rays, whose samples lie in the pixels of the block */
+  FrustumCull frustumCull;
+  const FrustumCull *cull = nullptr;
+  if (scene->cullBlock(offset.cast<float>(), (offset + size).cast<float>(),
+                       frustumCull))
+    cull = &frustumCull;
+
+  /* Trace the camera rays by packets if the integrator supports it */
+  if (integrator->packetSize() > 0) {
+    renderBlockPackets(scene, sampler, block, integrator->packetSize(), cull);
+    RayStats::local().primaryRays +=
+        long(size.x()) * size.y() * sampler->getSampleCount();
+    return;
+  }
+
   /* For each pixel and pixel sample */
   for (int y = 0; y < size.y(); ++y) {
     for (int x = 0; x < size.x(); ++x) {
@@ -296,6 +390,7 @@ void Viewer::renderBlock(Scene *scene, Sampler *sampler, ImageBlock &block) {
               Point2f(x + offset.x() + 0.5f, y + offset.y() + 0.5f);
           Ray ray;
           camera->sampleRay(ray, pixelSample);
+          ray.frustumCull = cull;
           Color3f radiance = integrator->Li(scene, sampler, ray);
           block.put(pixelSample, radiance);
       } else {
@@ -305,6 +400,7 @@ void Viewer::renderBlock(Scene *scene, Sampler *sampler, ImageBlock &block) {
               sampler->next2D();
           Ray ray;
           camera->sampleRay(ray, pixelSample);
+          ray.frustumCull = cull;
           Color3f radiance = integrator->Li(scene, sampler, ray);
           block.put(pixelSample, radiance);
           sampler->advance();
@@ -312,6 +408,8 @@ void Viewer::renderBlock(Scene *scene, Sampler *sampler, ImageBlock &block) {
       }
     }
   }
+  RayStats::local().primaryRays +=
+      long(size.x()) * size.y() * sampler->getSampleCount();
 }
 
 void Viewer::render(Scene *scene, ImageBlock *result, bool *done,
@@ -333,6 +431,7 @@ void Viewer::render(Scene *scene, ImageBlock *result, bool *done,
 
   cout << "Rendering .. ";
   cout.flush();
+  RayStats::reset();
   Timer timer;
 
   tbb::blocked_range<int> range(0, blockGenerator.getBlockCount());
@@ -367,7 +466,9 @@ void Viewer::render(Scene *scene, ImageBlock *result, bool *done,
   /// (equivalent to the following single-threaded call)
   // map(range);
 
-  cout << "done. (took " << timer.elapsedString() << ")" << endl;
+  double elapsed = timer.elapsed();
+  cout << "done. (took " << timeString(elapsed) << ")" << endl;
+  cout << RayStats::collect().toString(elapsed) << endl;
   *done = true;
 }
 
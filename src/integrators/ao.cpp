@@ -3,11 +3,17 @@
 #include "integrator.h"
 #include "scene.h"
 
+#include <memory>
+
 class AO : public Integrator {
 public:
   AO(const PropertyList &props) {
     m_sampleCount = props.getInteger("sampleCount", 32);
     m_cosineWeighted = props.getBoolean("cosineWeighted", true);
+    /* With <integer name="packetSize" value="16"/>, the camera rays are
+       traced by packets and the AO rays of all the pixels of a packet are
+       traced together as one stream */
+    m_packetSize = packetSizeProperty(props);
   }
 
   Color3f Li(const Scene *scene, Sampler *sampler, const Ray &ray) const {
@@ -22,34 +28,91 @@ public:
     
     float integSum = 0.f;
     for(int i=0; i< m_sampleCount; i++){
-      // Envoie de rayon sur l'émisphere
-      Vector3f wkLocal = (m_cosineWeighted ? Warp::squareToCosineHemisphere(sampler->next2D()) : Warp::squareToUniformHemisphere(sampler->next2D()));
-      // Passage de repère local au repère monde
-      Vector3f wkWorld = hit.toWorld(wkLocal).normalized();
-      Ray r = Ray(pos + normal * Epsilon,  wkWorld,true);
-      Hit shadow;
-      scene->intersect(r,shadow);
-      if(!shadow.foundIntersection()){ 
-        float cosTerm = std::max(0.f, normal.dot(wkWorld));
-        float pdf = ( m_cosineWeighted ? Warp::squareToCosineHemispherePdf(wkLocal) : Warp::squareToUniformHemispherePdf(wkLocal));
-        integSum +=  cosTerm / pdf;
+      float weight;
+      Ray r = sampleRay(sampler->next2D(), hit, pos, normal, weight);
+      if(!scene->occluded(r, std::numeric_limits<float>::max())){ 
+        integSum +=  weight;
       }
     }
 
     return Color3f(integSum/(M_PI*m_sampleCount));
   }
 
+  void LiPacket(const Scene *scene, const RayPacket &packet,
+                const Point2f *samples2D, Color3f *radiance) const {
+    Hit hits[RayPacket::MaxSize];
+    scene->intersect(packet, hits);
+
+    // the AO rays of the lanes which hit a surface, m_sampleCount per lane
+    std::vector<Ray> rays;
+    std::vector<float> weights;
+    rays.reserve(packet.size * m_sampleCount);
+    weights.reserve(packet.size * m_sampleCount);
+    for (int lane = 0; lane < packet.size; ++lane) {
+      if (!packet.isActive(lane))
+        continue;
+      const Hit &hit = hits[lane];
+      if (!hit.foundIntersection()) {
+        radiance[lane] = scene->backgroundColor();
+        continue;
+      }
+      Normal3f normal = hit.localFrame.n;
+      Point3f pos = packet.rays[lane].at(hit.t);
+      const Point2f *laneSamples = samples2D + lane * m_sampleCount;
+      for (int i = 0; i < m_sampleCount; ++i) {
+        float weight;
+        rays.push_back(sampleRay(laneSamples[i], hit, pos, normal, weight));
+        weights.push_back(weight);
+      }
+    }
+    std::unique_ptr<bool[]> occluded(new bool[rays.size()]);
+    scene->occluded(rays.data(), rays.size(), occluded.get());
+
+    int k = 0;
+    for (int lane = 0; lane < packet.size; ++lane) {
+      if (!packet.isActive(lane) || !hits[lane].foundIntersection())
+        continue;
+      float integSum = 0.f;
+      for (int i = 0; i < m_sampleCount; ++i, ++k) {
+        if (!occluded[k])
+          integSum += weights[k];
+      }
+      radiance[lane] = Color3f(integSum / (M_PI * m_sampleCount));
+    }
+  }
+
+  int packetSize() const { return m_packetSize; }
+
+  int packetSamples2D() const { return m_sampleCount; }
+
   std::string toString() const {
     return tfm::format("AO[\n"
                        "  samples = %f\n"
                        "  cosine-weighted = %s\n"
+                       "  packetSize = %i\n"
                        " ]",
-                       m_sampleCount, m_cosineWeighted ? "true" : "false");
+                       m_sampleCount, m_cosineWeighted ? "true" : "false",
+                       m_packetSize);
   }
 
 private:
+  /** Samples with \a sample an AO ray leaving \a pos around \a normal, whose
+   * contribution if it is not occluded is \a weight (cosine over pdf) */
+  Ray sampleRay(const Point2f &sample, const Hit &hit, const Point3f &pos,
+                const Normal3f &normal, float &weight) const {
+    // Envoie de rayon sur l'émisphere
+    Vector3f wkLocal = (m_cosineWeighted ? Warp::squareToCosineHemisphere(sample) : Warp::squareToUniformHemisphere(sample));
+    // Passage de repère local au repère monde
+    Vector3f wkWorld = hit.toWorld(wkLocal).normalized();
+    float cosTerm = std::max(0.f, normal.dot(wkWorld));
+    float pdf = ( m_cosineWeighted ? Warp::squareToCosineHemispherePdf(wkLocal) : Warp::squareToUniformHemispherePdf(wkLocal));
+    weight = cosTerm / pdf;
+    return Ray(pos + normal * Epsilon, wkWorld, true);
+  }
+
   int m_sampleCount;
   bool m_cosineWeighted;
+  int m_packetSize;
 };
 
 REGISTER_CLASS(AO, "ao")
@@ -27,9 +27,7 @@ public:
       Vector3f lightDir;
       Color3f intensity = (*it)->sample(pos, sampler->next2D(), pdf, lightDir, dist);
       Ray shadowRay(pos + normal * Epsilon, lightDir, true);
-      Hit shadowHit;
-      scene->intersect(shadowRay, shadowHit);
-      if (!shadowHit.foundIntersection() || shadowHit.t > dist) {
+      if (!scene->occluded(shadowRay, dist)) {
         float cos_term = std::max(0.f, lightDir.dot(normal));
         Color3f brdf =
             bsdf->eval(BSDFQueryRecord(hit.toLocal(-ray.direction),
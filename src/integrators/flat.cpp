@@ -5,13 +5,37 @@
 
 class FlatIntegrator : public Integrator {
 public:
-  FlatIntegrator(const PropertyList &props) { /* No parameters this time */
+  FlatIntegrator(const PropertyList &props) {
+    /* Optional <integer name="packetSize" value="8"/> to trace the camera
+     * rays by packets */
+    m_packetSize = packetSizeProperty(props);
   }
 
   Color3f Li(const Scene *scene, Sampler *sampler, const Ray &ray) const {
     /* Find the surface that is visible in the requested direction */
     Hit hit;
     scene->intersect(ray, hit);
+    return shade(ray, hit);
+  }
+
+  void LiPacket(const Scene *scene, const RayPacket &packet,
+                const Point2f *samples2D, Color3f *radiance) const {
+    Hit hits[RayPacket::MaxSize];
+    scene->intersect(packet, hits);
+    for (int lane = 0; lane < packet.size; ++lane) {
+      if (packet.isActive(lane))
+        radiance[lane] = shade(packet.rays[lane], hits[lane]);
+    }
+  }
+
+  int packetSize() const { return m_packetSize; }
+
+  std::string toString() const {
+    return tfm::format("FlatIntegrator[packetSize = %i]", m_packetSize);
+  }
+
+private:
+  Color3f shade(const Ray &ray, const Hit &hit) const {
     if (!hit.foundIntersection())
       return Color3f(0.0f);
 
@@ -22,7 +46,7 @@ public:
     return albedo;
   }
 
-  std::string toString() const { return "FlatIntegrator[]"; }
+  int m_packetSize;
 };
 
 REGISTER_CLASS(FlatIntegrator, "flat")
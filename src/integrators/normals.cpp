@@ -4,13 +4,36 @@
 class NormalsIntegrator : public Integrator {
 public:
     NormalsIntegrator(const PropertyList &props) {
-        /* No parameters this time */
+        /* Optional <integer name="packetSize" value="8"/> to trace the
+           camera rays by packets */
+        m_packetSize = packetSizeProperty(props);
     }
 
     Color3f Li(const Scene *scene, Sampler *sampler, const Ray &ray) const {
         /* Find the surface that is visible in the requested direction */
         Hit hit;
         scene->intersect(ray, hit);
+        return shade(hit);
+    }
+
+    void LiPacket(const Scene *scene, const RayPacket &packet,
+                  const Point2f *samples2D, Color3f *radiance) const {
+        Hit hits[RayPacket::MaxSize];
+        scene->intersect(packet, hits);
+        for (int lane = 0; lane < packet.size; ++lane) {
+            if (packet.isActive(lane))
+                radiance[lane] = shade(hits[lane]);
+        }
+    }
+
+    int packetSize() const { return m_packetSize; }
+
+    std::string toString() const {
+        return tfm::format("NormalIntegrator[packetSize = %i]", m_packetSize);
+    }
+
+private:
+    Color3f shade(const Hit &hit) const {
         if (!hit.foundIntersection())
             return Color3f(0.0f);
 
@@ -20,9 +43,7 @@ public:
         return Color3f(n[0],n[1],n[2]);
     }
 
-    std::string toString() const {
-        return "NormalIntegrator[]";
-    }
+    int m_packetSize;
 };
 
 REGISTER_CLASS(NormalsIntegrator, "normals")
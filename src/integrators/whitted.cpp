@@ -58,9 +58,8 @@ public:
       if (pdf <= Epsilon)
         continue;
       Ray shadowRay(pos + normal * Epsilon, lightDir, true);
-      Hit shadowHit;
-      scene->intersect(shadowRay, shadowHit);
-      if (shadowHit.shape != light->shape() && shadowHit.t < dist) {
+      // stop just before the light so that its own shape does not occlude it
+      if (scene->occluded(shadowRay, dist - Epsilon)) {
         continue;
       }
       float cos_term = std::max(0.f, lightDir.dot(normal));
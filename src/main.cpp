@@ -7,6 +7,7 @@
 #include "integrator.h"
 #include "sampler.h"
 #include "viewer.h"
+#include "accelerators/bvhcache.h"
 
 #include <tbb/parallel_for.h>
 #include <tbb/blocked_range.h>
@@ -45,7 +46,7 @@ static void render(Scene *scene, const std::string &filename) {
 
 int main(int argc, char **argv) {
     if (argc <= 1) {
-        cerr << "Syntax: " << argv[0] << " <scene.scn | image.exr> [--no-gui] [--threads N]" <<  endl;
+        cerr << "Syntax: " << argv[0] << " <scene.scn | image.exr> [--no-gui] [--threads N] [--bvh-cache DIR]" <<  endl;
         return -1;
     }
 
@@ -72,6 +73,21 @@ int main(int argc, char **argv) {
             gui = false;
             continue;
         }
+        else if (token == "--bvh-cache") {
+            /* Directory of the on-disk cache of the mesh BVHs */
+            if (i+1 >= argc) {
+                cerr << "\"--bvh-cache\" argument expects a directory following it." << endl;
+                return -1;
+            }
+            try {
+                BVHCache::setDirectory(argv[i+1]);
+            } catch (const std::exception &e) {
+                cerr << "Fatal error: " << e.what() << endl;
+                return -1;
+            }
+            i++;
+            continue;
+        }
 
         filesystem::path path(argv[i]);
 
@@ -133,7 +149,13 @@ int main(int argc, char **argv) {
                 delete viewer;
                 nanogui::shutdown();
             } else {
-                std::unique_ptr<Object> root(loadFromXML(sceneName));
+                std::unique_ptr<Object> root;
+                {
+                    /* The acceleration structures are built in parallel
+                       while loading, with the requested number of threads */
+                    tbb::task_scheduler_init init(threadCount < 0 ? tbb::task_scheduler_init::automatic : threadCount);
+                    root.reset(loadFromXML(sceneName));
+                }
                 /* When the XML root object is a scene, start rendering it .. */
                 if (root->getClassType() == Object::EScene)
                     render(static_cast<Scene *>(root.get()), sceneName);
@@ -4,28 +4,39 @@
 Disk::Disk(const PropertyList &propList) {
   m_radius = propList.getFloat("radius", 1.f);
   m_transformation = propList.getTransform("toWorld", Transform());
+  m_AABB = BoundingBox3f(Point3f(-m_radius, -m_radius, 0.f),
+                         Point3f(m_radius, m_radius, 0.f));
 }
 
-bool Disk::intersect(const Ray &ray, Hit &hit) const {
+bool Disk::intersectDistance(const Ray &ray, float tMax, float &t) const {
   // dot product close to zero => ray parallel to the plane
   if (ray.direction.z() == 0.f) 
     return false;
 
-  float t = -ray.origin.z() / ray.direction.z();
-
-  if (t <= 0.f)
+  t = -ray.origin.z() / ray.direction.z();
+  if (t < ray.tMin || t > std::min(tMax, ray.tMax))
     return false;
 
   Point3f pos = ray.at(t);
+  return pos.x() * pos.x() + pos.y() * pos.y() <= m_radius * m_radius;
+}
 
-  float dist2 = pos.x() * pos.x() + pos.y() * pos.y();
-  if (dist2 > m_radius * m_radius)
-    return false;
+bool Disk::occluded(const Ray &ray, float tMax) const {
+  float t;
+  return intersectDistance(ray, tMax, t);
+}
 
+bool Disk::intersect(const Ray &ray, Hit &hit) const {
+  float t;
+  if (!intersectDistance(ray, hit.t, t))
+    return false;
   hit.t = t;
+  return true;
+}
 
-  if (ray.shadowRay)
-      return true;
+void Disk::computeSurfaceInteraction(const Ray &ray, Hit &hit) const {
+  Point3f pos = ray.at(hit.t);
+  float dist2 = pos.x() * pos.x() + pos.y() * pos.y();
 
   hit.localFrame = Frame(Normal3f(0.0, 0.0, 1.0));
 
@@ -37,8 +48,6 @@ bool Disk::intersect(const Ray &ray, Hit &hit) const {
   float v = (m_radius - rHit) / m_radius;
 
   hit.uv = Point2f(u, v);
-
-  return true;
 }
 
 void Disk::sample(const Point2f &sample, Point3f &p, Normal3f &n,
@@ -11,7 +11,11 @@ public:
 
   float radius() const { return m_radius; }
 
+  virtual const BoundingBox3f &getBoundingBox() const { return m_AABB; }
+
   virtual bool intersect(const Ray &ray, Hit &hit) const;
+  virtual bool occluded(const Ray &ray, float tMax) const;
+  virtual void computeSurfaceInteraction(const Ray &ray, Hit &hit) const;
 
   virtual void sample(const Point2f &sample, Point3f &p, Normal3f &n,
                       float &pdf) const;
@@ -31,5 +35,9 @@ public:
   }
 
 protected:
+  /// Computes the distance \a t of the hit, if it is lower than \a tMax
+  bool intersectDistance(const Ray &ray, float tMax, float &t) const;
+
   float m_radius;
+  BoundingBox3f m_AABB;
 };
@@ -0,0 +1,62 @@
+#include "shapes/instance.h"
+
+Instance::Instance(const PropertyList &propList) {
+  m_toWorld = propList.getTransform("toWorld", Transform());
+  m_meshId = propList.getString("mesh", "");
+}
+
+Instance::~Instance() {
+  if (m_ownsMesh)
+    delete m_mesh;
+}
+
+void Instance::addChild(Object *obj) {
+  if (obj->getClassType() != EShape) {
+    Shape::addChild(obj);
+    return;
+  }
+  Mesh *mesh = dynamic_cast<Mesh *>(obj);
+  if (!mesh)
+    throw RTException("Instance: only meshes can be instantiated");
+  if (m_mesh || !m_meshId.empty())
+    throw RTException("Instance: tried to register multiple meshes!");
+  mesh->prepareAccelerator();
+  m_mesh = mesh;
+  m_ownsMesh = true;
+}
+
+void Instance::setParent(Object *parent) {
+  if (parent->getClassType() == ELight)
+    throw RTException("Instance: instances cannot be area lights, declare "
+                      "the emitting mesh itself in the light");
+  Shape::setParent(parent);
+}
+
+void Instance::activate() {
+  if (m_mesh)
+    setMesh(m_mesh);
+  else if (m_meshId.empty())
+    throw RTException("Instance: no mesh was specified (expected a "
+                      "<string name=\"mesh\"> property or a nested mesh)");
+}
+
+void Instance::setMesh(const Mesh *mesh) {
+  m_mesh = mesh;
+  m_transformation = m_toWorld * m_mesh->transformation();
+  if (!m_bsdf)
+    m_bsdf = m_mesh->bsdf();
+}
+
+std::string Instance::toString() const {
+  return tfm::format("Instance[\n"
+                     "  mesh = %s (%i triangles),\n"
+                     "  toWorld = %s,\n"
+                     "  BSDF = %s\n"
+                     "]",
+                     m_meshId.empty() ? std::string("nested") : m_meshId,
+                     m_mesh ? m_mesh->nbFaces() : 0,
+                     indent(m_toWorld.toString(), 12),
+                     m_bsdf ? indent(m_bsdf->toString()) : std::string("null"));
+}
+
+REGISTER_CLASS(Instance, "instance")
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "shape.h"
+#include "shapes/mesh.h"
+
+/** \class Instance
+ * A shape reusing the geometry and the BVH of a mesh with its own
+ * transformation and BSDF, so that the memory of a scene grows with its
+ * unique geometry rather than with its number of instances, e.g.
+ * \code
+ * <shape type="mesh">
+ *   <string name="filename" value="tree.obj"/>
+ *   <string name="id" value="tree"/>
+ * </shape>
+ * <shape type="instance">
+ *   <string name="mesh" value="tree"/>
+ *   <transform name="toWorld"> ... </transform>
+ *   <bsdf type="diffuse"> ... </bsdf>
+ * </shape>
+ * \endcode
+ * The ids are those of the meshes of the same scene, which resolves them
+ * (see Scene::addChild()). The mesh may also be declared inside an instance:
+ * it is then owned by the instance and only rendered through it. Instances
+ * cannot be area lights.
+ *
+ * The instance is placed at its toWorld transformation applied after the one
+ * of the mesh, and uses the BSDF of the mesh if it has none. Each instance is
+ * one primitive of the top-level BVH of the scene, the rays are moved to the
+ * object space of the mesh and traverse its BVH.
+ */
+class Instance : public Shape {
+public:
+  Instance(const PropertyList &propList);
+  virtual ~Instance();
+
+  virtual void activate();
+
+  /// Accepts the mesh, declared inside the instance, and the BSDF
+  virtual void addChild(Object *child);
+
+  /// Rejects the area lights, whose sampling is not supported
+  virtual void setParent(Object *parent);
+
+  /** Id of the mesh given by the property "mesh", to resolve with setMesh(),
+   * or an empty string for a nested mesh */
+  const std::string &meshId() const { return m_meshId; }
+
+  /// Uses \a mesh, whose id is meshId()
+  void setMesh(const Mesh *mesh);
+
+  virtual bool intersect(const Ray &ray, Hit &hit) const {
+    return m_mesh->intersect(ray, hit);
+  }
+  virtual void intersectPacket(const RayPacket &packet, uint32_t mask,
+                               Hit *hits) const {
+    m_mesh->intersectPacket(packet, mask, hits);
+  }
+  virtual bool occluded(const Ray &ray, float tMax) const {
+    return m_mesh->occluded(ray, tMax);
+  }
+  virtual void occludedStream(const Ray *rays, const int *ids, int count,
+                              bool *isOccluded) const {
+    m_mesh->occludedStream(rays, ids, count, isOccluded);
+  }
+  virtual void computeSurfaceInteraction(const Ray &ray, Hit &hit) const {
+    m_mesh->computeSurfaceInteraction(ray, hit);
+  }
+
+  virtual const BoundingBox3f &getBoundingBox() const {
+    return m_mesh->getBoundingBox();
+  }
+
+  const Mesh *mesh() const { return m_mesh; }
+
+  /// Return a human-readable summary
+  std::string toString() const;
+
+protected:
+  const Mesh *m_mesh = nullptr;
+  std::string m_meshId;
+  /// True if m_mesh was declared inside the instance
+  bool m_ownsMesh = false;
+  /// Transformation of the instance, applied after the one of the mesh
+  Transform m_toWorld;
+};
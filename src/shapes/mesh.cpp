@@ -1,18 +1,146 @@
 #include "shapes/mesh.h"
+#include "shapes/meshparser.h"
 #include "accelerators/bvh.h"
+#include "accelerators/bvhcache.h"
+#include "accelerators/kdtree.h"
+#include "stats.h"
+#include "timer.h"
 #include "warp.h"
 
+#include <algorithm>
 #include <filesystem/resolver.h>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <limits>
-#include <tiny_obj_loader.h>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
+#include <tbb/task_arena.h>
+#include <unordered_map>
+
+/// Hash of the (position, texcoord, normal) indices of a face corner
+struct CornerHash {
+  size_t operator()(const MeshFileContent::Corner &corner) const {
+    size_t h = std::hash<int>()(corner.position);
+    h = h * 31 + std::hash<int>()(corner.texcoord);
+    return h * 31 + std::hash<int>()(corner.normal);
+  }
+};
+
+struct CornerEqual {
+  bool operator()(const MeshFileContent::Corner &a,
+                  const MeshFileContent::Corner &b) const {
+    return a.position == b.position && a.texcoord == b.texcoord &&
+           a.normal == b.normal;
+  }
+};
+
+BVH::BuildParams Mesh::bvhParams(const PropertyList &props) {
+  /* BVH construction parameters, e.g.
+   *   <string name="bvhSplit" value="sah"/>  (or "middle", "equal", "sbvh",
+   *     "lbvh" or "hlbvh" for the fast linear builds of large meshes)
+   *   <float name="bvhSplitBudget" value="0.3"/>  (references duplicated by
+   *     the spatial splits of "sbvh", relative to the number of triangles)
+   *   <integer name="bvhLeafSize" value="10"/>
+   *   <integer name="bvhBins" value="12"/>
+   *   <float name="bvhTraversalCost" value="0.125"/>
+   *   <integer name="bvhWidth" value="4"/>  (2, 4 or 8 children per node)
+   *   <integer name="bvhLeafPack" value="4"/>  (1, 4 or 8 triangles per
+   *     SIMD test in the leaves)
+   *   <integer name="bvhQuantization" value="8"/>  (8 or 16 bits bounds in
+   *     the wide nodes, 0 for floats)
+   *   <float name="bvhRebuildThreshold" value="1.5"/>  (SAH cost increase
+   *     above which updateBVH() rebuilds instead of refitting)
+   */
+  BVH::BuildParams params;
+  params.splitMethod =
+      BVH::splitMethodFromString(props.getString("bvhSplit", "sah"));
+  params.targetCellSize =
+      props.getInteger("bvhLeafSize", params.targetCellSize);
+  params.maxDepth = props.getInteger("bvhMaxDepth", params.maxDepth);
+  params.nbBins = props.getInteger("bvhBins", params.nbBins);
+  params.traversalCost =
+      props.getFloat("bvhTraversalCost", params.traversalCost);
+  params.splitBudget = props.getFloat("bvhSplitBudget", params.splitBudget);
+  params.width = props.getInteger("bvhWidth", params.width);
+  params.leafAlignment = props.getInteger("bvhLeafPack", params.leafAlignment);
+  params.quantization =
+      props.getInteger("bvhQuantization", params.quantization);
+  params.rebuildThreshold =
+      props.getFloat("bvhRebuildThreshold", params.rebuildThreshold);
+  if (params.leafAlignment != 1 && params.leafAlignment != 4 &&
+      params.leafAlignment != 8)
+    throw RTException("Mesh: unsupported leaf pack size %i (expected 1, 4 "
+                      "or 8)",
+                      params.leafAlignment);
+  return params;
+}
+
+KDTree::BuildParams Mesh::kdtreeParams(const PropertyList &props) {
+  /* kd-tree construction parameters, used with
+   * <string name="accelerator" value="kdtree"/>, e.g.
+   *   <float name="kdIntersectCost" value="80"/>  (relative to the cost of
+   *     traversing a node)
+   *   <float name="kdTraversalCost" value="1"/>
+   *   <float name="kdEmptyBonus" value="0.5"/>
+   *   <integer name="kdLeafSize" value="1"/>
+   *   <integer name="kdMaxDepth" value="-1"/>  (8 + 1.3 log2(n) if negative)
+   */
+  KDTree::BuildParams params;
+  params.intersectCost =
+      props.getFloat("kdIntersectCost", params.intersectCost);
+  params.traversalCost =
+      props.getFloat("kdTraversalCost", params.traversalCost);
+  params.emptyBonus = props.getFloat("kdEmptyBonus", params.emptyBonus);
+  params.targetCellSize =
+      props.getInteger("kdLeafSize", params.targetCellSize);
+  params.maxDepth = props.getInteger("kdMaxDepth", params.maxDepth);
+  return params;
+}
 
 Mesh::Mesh(const PropertyList &propList) : m_BVH(nullptr) {
   m_transformation = propList.getTransform("toWorld", ::Transform());
   std::string filename = propList.getString("filename");
+  // optional <string name="id" value="..."/>, to reference it from instances
+  m_id = propList.getString("id", "");
+
+  // "bvh", "kdtree" or "bruteforce"
+  m_accelerator =
+      acceleratorFromString(propList.getString("accelerator", "bvh"));
+  m_bvhParams = bvhParams(propList);
+  m_kdtreeParams = kdtreeParams(propList);
+
   loadFromFile(filename);
-  buildBVH();
+  updateTriangleAccelerator();
+}
+
+Mesh::Mesh(const std::vector<const Mesh *> &meshes,
+           const BVH::BuildParams &params)
+    : m_sourceMeshes(meshes), m_BVH(nullptr), m_bvhParams(params) {
+  size_t nbVertices = 0, nbFaces = 0;
+  for (const Mesh *mesh : meshes) {
+    nbVertices += mesh->m_vertices.size();
+    nbFaces += mesh->m_faces.size();
+  }
+  m_vertices.reserve(nbVertices);
+  m_faces.reserve(nbFaces);
+  m_faceSources.reserve(nbFaces);
+  for (size_t i = 0; i < meshes.size(); ++i) {
+    const Transform &trafo = meshes[i]->transformation();
+    int offset = m_vertices.size();
+    // the normals are not renormalized, as for the instances: they are
+    // interpolated then normalized by computeSurfaceInteraction()
+    for (const Vertex &v : meshes[i]->m_vertices)
+      m_vertices.push_back(Vertex(trafo * v.position, trafo * v.normal,
+                                  v.texcoord));
+    for (const FaceIndex &face : meshes[i]->m_faces) {
+      m_faces.push_back(face.array() + offset);
+      m_faceSources.push_back(i);
+    }
+  }
+  computeBoundingBox();
+  buildAccelerator();
 }
 
 void Mesh::activate() {
@@ -21,6 +149,10 @@ void Mesh::activate() {
     m_bsdf = static_cast<BSDF *>(
         ObjectFactory::createInstance("diffuse", PropertyList()));
   }
+  computeAreaPDF();
+}
+
+void Mesh::computeAreaPDF() {
   m_PDF = DiscretePDF(m_faces.size());
   for (uint32_t i = 0; i < m_faces.size(); i++) {
     Point3f p0 = m_transformation * vertexOfFace(i, 0).position;
@@ -38,120 +170,118 @@ void Mesh::loadFromFile(const std::string &filename) {
   if (is.fail())
     throw RTException("Unable to open mesh file \"%s\"!", filepath.str());
 
+  m_filePath = filepath.str();
   const std::string ext = filepath.extension();
-  if (ext == "off" || ext == "OFF")
+  Timer timer;
+  if (ext == "off" || ext == "OFF") {
     loadOFF(filepath.str());
-  else if (ext == "obj" || ext == "OBJ")
+  } else if (ext == "obj" || ext == "OBJ") {
     loadOBJ(filepath.str());
-  else
+  } else {
     std::cerr << "Mesh: extension \'" << ext << "\' not supported."
               << std::endl;
-}
-
-void Mesh::loadOFF(const std::string &filename) {
-  std::ifstream in(filename.c_str(), std::ios::in);
-  if (!in) {
-    std::cerr << "File not found " << filename << std::endl;
-    return;
-  }
-
-  std::string header;
-  in >> header;
-
-  // check the header file
-  if (header != "OFF") {
-    std::cerr << "Wrong header = " << header << std::endl;
     return;
   }
+  cout << "Mesh \"" << filepath.filename() << "\" loaded in "
+       << timer.elapsedString() << ": " << m_vertices.size()
+       << " vertices, " << m_faces.size() << " triangles" << endl;
+}
 
-  int nofVertices, nofFaces, inull;
-  int nb, id0, id1, id2;
-  Vector3f v;
-
-  in >> nofVertices >> nofFaces >> inull;
-
-  for (int i = 0; i < nofVertices; ++i) {
-    in >> v.x() >> v.y() >> v.z();
-    m_vertices.push_back(Vertex(v));
-  }
-
-  for (int i = 0; i < nofFaces; ++i) {
-    in >> nb >> id0 >> id1 >> id2;
-    assert(nb == 3);
-    m_faces.push_back(FaceIndex(id0, id1, id2));
-  }
-
-  in.close();
-
+void Mesh::loadOFF(const std::string &filename) {
+  MeshFileContent content;
+  parseOFF(filename, content);
+  setContent(content);
   computeNormals();
-  computeBoundingBox();
 }
 
 void Mesh::loadOBJ(const std::string &filename) {
-  tinyobj::attrib_t attrib;
-  std::vector<tinyobj::shape_t> shapes;
-  std::vector<tinyobj::material_t> materials;
-  std::string err, warn;
-  bool success = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err,
-                                  filename.c_str());
-
-  if (!success) {
-    throw RTException("Mesh::loadObj: error loading file %s: %s", filename,
-                      err);
-  }
+  MeshFileContent content;
+  parseOBJ(filename, content);
+  setContent(content);
+  // the faces without "vn" may be mixed with faces with normals
+  computeNormals();
+}
 
-  bool needNormals = false;
-
-  int face_idx = 0;
-
-  // Loop over shapes
-  for (size_t s = 0; s < shapes.size(); s++) {
-    // Loop over faces
-    size_t index_offset = 0;
-    for (size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++) {
-      size_t fv = shapes[s].mesh.num_face_vertices[f];
-      assert(fv == 3);
-
-      // Loop over vertices in the face.
-      for (size_t v = 0; v < fv; v++) {
-        // access to vertex
-        tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
-
-        Point3f pos;
-        pos[0] = attrib.vertices[3 * idx.vertex_index + 0];
-        pos[1] = attrib.vertices[3 * idx.vertex_index + 1];
-        pos[2] = attrib.vertices[3 * idx.vertex_index + 2];
-
-        Vector3f n;
-        if (attrib.normals.size() > 0) {
-          n[0] = attrib.normals[3 * idx.normal_index + 0];
-          n[1] = attrib.normals[3 * idx.normal_index + 1];
-          n[2] = attrib.normals[3 * idx.normal_index + 2];
-        } else {
-          needNormals = true;
-        }
+void Mesh::setContent(const MeshFileContent &content) {
+  typedef MeshFileContent::Corner Corner;
+  const std::vector<Corner> &corners = content.corners;
+  int nbFaces = content.nbTriangles();
+  bool hasTexcoords = !content.texcoords.empty();
+  bool hasNormals = !content.normals.empty();
 
-        Vector2f tc = Vector2f::Zero();
-        if (attrib.texcoords.size() > 0) {
-          tc[0] = attrib.texcoords[2 * idx.texcoord_index + 0];
-          tc[1] = attrib.texcoords[2 * idx.texcoord_index + 1];
+  /* In the OFF files and most OBJ files, all the attributes of a corner have
+     the same index: the vertices are then the positions, in parallel */
+  bool sameIndices = tbb::parallel_reduce(
+      tbb::blocked_range<size_t>(0, corners.size()), true,
+      [&](const tbb::blocked_range<size_t> &range, bool same) {
+        for (size_t i = range.begin(); same && i < range.end(); ++i) {
+          const Corner &c = corners[i];
+          same = c.texcoord == (hasTexcoords ? c.position : -1) &&
+                 c.normal == (hasNormals ? c.position : -1);
         }
-        m_vertices.push_back(Vertex(pos, n, tc));
-      }
-
-      m_faces.push_back(FaceIndex(face_idx, face_idx + 1, face_idx + 2));
-      face_idx += 3;
-      index_offset += fv;
-    }
+        return same;
+      },
+      std::logical_and<bool>());
+  if (sameIndices) {
+    m_vertices.clear();
+    m_vertices.resize(content.positions.size());
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, m_vertices.size()),
+        [&](const tbb::blocked_range<size_t> &range) {
+          for (size_t i = range.begin(); i < range.end(); ++i) {
+            Vertex &v = m_vertices[i];
+            v.position = content.positions[i];
+            if (i < content.normals.size())
+              v.normal = content.normals[i];
+            if (i < content.texcoords.size())
+              v.texcoord = content.texcoords[i];
+          }
+        });
+    m_computedNormals.assign(m_vertices.size(), !hasNormals);
+    m_faces.resize(nbFaces);
+    tbb::parallel_for(tbb::blocked_range<int>(0, nbFaces),
+                      [&](const tbb::blocked_range<int> &range) {
+                        for (int i = range.begin(); i < range.end(); ++i)
+                          m_faces[i] = FaceIndex(corners[3 * i].position,
+                                                 corners[3 * i + 1].position,
+                                                 corners[3 * i + 2].position);
+                      });
+    m_AABB = content.bbox;
+    return;
   }
 
-  if (needNormals) {
-    computeNormals();
+  /* The face corners sharing the same position, normal and texture
+     coordinates indices share the same vertex: this is what lets
+     computeNormals() smooth the normals across the faces */
+  std::unordered_map<Corner, int, CornerHash, CornerEqual> vertexIds;
+  vertexIds.reserve(content.positions.size());
+  m_vertices.clear();
+  m_computedNormals.clear();
+  m_faces.resize(nbFaces);
+  for (int i = 0; i < nbFaces; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      const Corner &c = corners[3 * i + j];
+      auto inserted = vertexIds.emplace(c, int(m_vertices.size()));
+      m_faces[i][j] = inserted.first->second;
+      if (!inserted.second)
+        continue;
+      Vertex v(content.positions[c.position]);
+      if (c.normal >= 0)
+        v.normal = content.normals[c.normal];
+      if (c.texcoord >= 0)
+        v.texcoord = content.texcoords[c.texcoord];
+      m_vertices.push_back(v);
+      m_computedNormals.push_back(c.normal < 0);
+    }
   }
   computeBoundingBox();
 }
 
-Mesh::~Mesh() { delete m_BVH; }
+Mesh::~Mesh() {
+  delete m_triangleAccelerator;
+  delete m_BVH;
+  delete m_kdtree;
+}
 
 void Mesh::makeUnitary() {
   Eigen::Vector3f lowest, highest;
@@ -169,95 +299,687 @@ void Mesh::makeUnitary() {
   for (VertexArray::iterator v_iter = m_vertices.begin();
        v_iter != m_vertices.end(); ++v_iter)
     v_iter->position = (v_iter->position - center) / m;
+  // the positions no longer match the file: the BVH must not be cached
+  m_filePath.clear();
 
   computeBoundingBox();
 }
 
 void Mesh::computeNormals() {
-  // pass 1: set the normal to 0
-  for (VertexArray::iterator v_iter = m_vertices.begin();
-       v_iter != m_vertices.end(); ++v_iter)
-    v_iter->normal.setZero();
-
-  // pass 2: compute face normals and accumulate
-  for (FaceIndexArray::iterator f_iter = m_faces.begin();
-       f_iter != m_faces.end(); ++f_iter) {
-    const Point3f v0 = m_vertices[(*f_iter)(0)].position;
-    const Point3f v1 = m_vertices[(*f_iter)(1)].position;
-    const Point3f v2 = m_vertices[(*f_iter)(2)].position;
+  if (std::find(m_computedNormals.begin(), m_computedNormals.end(), true) ==
+      m_computedNormals.end())
+    return;
+  int nbVertices = m_vertices.size(), nbFaces = m_faces.size();
 
-    Normal3f n = (v1 - v0).cross(v2 - v0);
+  // pass 1: compute the face normals
+  std::vector<Normal3f> faceNormals(nbFaces);
+  tbb::parallel_for(tbb::blocked_range<int>(0, nbFaces),
+                    [&](const tbb::blocked_range<int> &range) {
+                      for (int i = range.begin(); i < range.end(); ++i) {
+                        const Point3f &v0 = vertexOfFace(i, 0).position;
+                        const Point3f &v1 = vertexOfFace(i, 1).position;
+                        const Point3f &v2 = vertexOfFace(i, 2).position;
+                        faceNormals[i] = (v1 - v0).cross(v2 - v0);
+                      }
+                    });
 
-    m_vertices[(*f_iter)(0)].normal += n;
-    m_vertices[(*f_iter)(1)].normal += n;
-    m_vertices[(*f_iter)(2)].normal += n;
+  // pass 2: list the faces around each vertex, in the face order
+  std::vector<int> firstFaces(nbVertices + 1, 0);
+  for (const FaceIndex &face : m_faces) {
+    for (int j = 0; j < 3; ++j)
+      ++firstFaces[face[j] + 1];
+  }
+  for (int i = 0; i < nbVertices; ++i)
+    firstFaces[i + 1] += firstFaces[i];
+  std::vector<int> vertexFaces(firstFaces[nbVertices]);
+  std::vector<int> next(firstFaces.begin(), firstFaces.end() - 1);
+  for (int i = 0; i < nbFaces; ++i) {
+    for (int j = 0; j < 3; ++j)
+      vertexFaces[next[m_faces[i][j]]++] = i;
   }
 
-  // pass 3: normalize
-  for (VertexArray::iterator v_iter = m_vertices.begin();
-       v_iter != m_vertices.end(); ++v_iter)
-    v_iter->normal.normalize();
+  /* pass 3: accumulate and normalize. The sums are done in the face order,
+     as sequentially, so that the normals do not depend on the threads. */
+  tbb::parallel_for(tbb::blocked_range<int>(0, nbVertices),
+                    [&](const tbb::blocked_range<int> &range) {
+                      for (int i = range.begin(); i < range.end(); ++i) {
+                        if (!m_computedNormals[i])
+                          continue;
+                        Normal3f n = Normal3f::Zero();
+                        for (int k = firstFaces[i]; k < firstFaces[i + 1]; ++k)
+                          n += faceNormals[vertexFaces[k]];
+                        m_vertices[i].normal = n.normalized();
+                      }
+                    });
 }
 
 void Mesh::computeBoundingBox() {
-  m_AABB.reset();
-  for (VertexArray::iterator v_iter = m_vertices.begin();
-       v_iter != m_vertices.end(); ++v_iter)
-    m_AABB.expandBy(v_iter->position);
+  m_AABB = tbb::parallel_reduce(
+      tbb::blocked_range<size_t>(0, m_vertices.size()), BoundingBox3f(),
+      [&](const tbb::blocked_range<size_t> &range, BoundingBox3f box) {
+        for (size_t i = range.begin(); i < range.end(); ++i)
+          box.expandBy(m_vertices[i].position);
+        return box;
+      },
+      [](BoundingBox3f a, const BoundingBox3f &b) {
+        a.expandBy(b);
+        return a;
+      });
+}
+
+std::vector<BoundingBox3f> Mesh::computeFaceBounds() const {
+  std::vector<BoundingBox3f> faceBounds(m_faces.size());
+  tbb::parallel_for(tbb::blocked_range<int>(0, m_faces.size()),
+                    [&](const tbb::blocked_range<int> &range) {
+                      for (int i = range.begin(); i < range.end(); ++i) {
+                        faceBounds[i] =
+                            BoundingBox3f(vertexOfFace(i, 0).position);
+                        faceBounds[i].expandBy(vertexOfFace(i, 1).position);
+                        faceBounds[i].expandBy(vertexOfFace(i, 2).position);
+                      }
+                    });
+  return faceBounds;
+}
+
+BVH::PrimitiveSplitter Mesh::faceSplitter() const {
+  return [this](int faceId, const BoundingBox3f &box, int dim, float position,
+                BoundingBox3f &left, BoundingBox3f &right) {
+    splitFace(faceId, box, dim, position, left, right);
+  };
+}
+
+void Mesh::buildAccelerator() {
+  delete m_BVH;
+  m_BVH = nullptr;
+  delete m_kdtree;
+  m_kdtree = nullptr;
+  m_triangles.clear();
+  m_packs4.clear();
+  m_packs8.clear();
+  if (m_accelerator == EKDTreeAccelerator)
+    buildKDTree();
+  else if (m_accelerator == EBVHAccelerator)
+    buildBVH();
+  updateTriangleAccelerator();
+  m_acceleratorBuilt = true;
+}
+
+void Mesh::prepareAccelerator() {
+  if (!m_acceleratorBuilt)
+    buildAccelerator();
 }
 
 void Mesh::buildBVH() {
   if (m_BVH)
     delete m_BVH;
   m_BVH = new BVH;
-  m_BVH->build(this, 10, 100);
+  Timer timer;
+  BVHCache cache(m_filePath, LoaderVersion, m_bvhParams);
+  if (cache.load(*m_BVH, m_faces.size())) {
+    buildTriangleRecords();
+    cout << "BVH of " << m_faces.size() << " triangles loaded in "
+         << timer.elapsedString() << ", "
+         << memString(m_BVH->memoryUsage()) << " of nodes and indices"
+         << endl;
+    return;
+  }
+  m_BVH->build(computeFaceBounds(), m_bvhParams, faceSplitter());
+  cache.store(*m_BVH);
+  buildTriangleRecords();
+  cout << "BVH of " << m_faces.size() << " triangles built in "
+       << timer.elapsedString() << " ("
+       << tbb::this_task_arena::max_concurrency() << " threads), "
+       << memString(m_BVH->memoryUsage()) << " of nodes and indices";
+  if (m_BVH->nbSplitReferences() > 0)
+    cout << ", " << m_BVH->nbSplitReferences()
+         << " references added by the spatial splits";
+  cout << endl;
 }
 
-long int Mesh::ms_itersection_count = 0;
+void Mesh::buildKDTree() {
+  delete m_kdtree;
+  m_kdtree = new KDTree;
+  Timer timer;
+  m_kdtree->build(computeFaceBounds(), m_kdtreeParams);
+  buildTriangleRecords();
+  cout << "kd-tree of " << m_faces.size() << " triangles built in "
+       << timer.elapsedString() << " ("
+       << tbb::this_task_arena::max_concurrency() << " threads), "
+       << m_kdtree->nbNodes() << " nodes, "
+       << memString(m_kdtree->memoryUsage()) << " of nodes and indices"
+       << endl;
+}
 
-bool Mesh::intersectFace(const Ray &ray, Hit &hit, int faceId) const {
-  ms_itersection_count++;
+void Mesh::updateBVH() {
+  if (!m_BVH) {
+    buildAccelerator();
+    return;
+  }
+  Timer timer;
+  float degradation;
+  bool rebuilt =
+      m_BVH->update(computeFaceBounds(), degradation, faceSplitter());
+  buildTriangleRecords();
+  cout << "BVH of " << m_faces.size() << " triangles "
+       << (rebuilt ? "rebuilt" : "refitted") << " in "
+       << timer.elapsedString() << " (SAH cost x" << degradation
+       << " after the refit)" << endl;
+}
+
+void Mesh::setPositions(const std::vector<Point3f> &positions) {
+  if (positions.size() != m_vertices.size())
+    throw RTException("Mesh::setPositions: %i positions given for %i "
+                      "vertices",
+                      positions.size(), m_vertices.size());
+  for (size_t i = 0; i < m_vertices.size(); ++i)
+    m_vertices[i].position = positions[i];
+  m_filePath.clear();
+  computeNormals();
+  computeBoundingBox();
+  computeAreaPDF();
+  updateBVH();
+}
+
+void Mesh::buildTriangleRecords() {
+  // positions of the triangles in the leaf order of the BVH or kd-tree,
+  // whose leaves are not aligned on the SIMD packs
+  m_triangles.clear();
+  m_packs4.clear();
+  m_packs8.clear();
+  const std::vector<int> &faceIds =
+      m_kdtree ? m_kdtree->primitiveIds() : m_BVH->primitiveIds();
+  int packSize = m_kdtree ? 1 : m_bvhParams.leafAlignment;
+  if (packSize == 4) {
+    buildPacks(m_packs4);
+  } else if (packSize == 8) {
+    buildPacks(m_packs8);
+  } else {
+    m_triangles.resize(faceIds.size());
+    tbb::parallel_for(tbb::blocked_range<int>(0, faceIds.size()),
+                      [&](const tbb::blocked_range<int> &range) {
+                        for (int i = range.begin(); i < range.end(); ++i) {
+                          int faceId = faceIds[i];
+                          const Point3f &p0 = vertexOfFace(faceId, 0).position;
+                          m_triangles[i].p0 = p0;
+                          m_triangles[i].e1 =
+                              vertexOfFace(faceId, 1).position - p0;
+                          m_triangles[i].e2 =
+                              vertexOfFace(faceId, 2).position - p0;
+                        }
+                      });
+  }
+}
+
+void Mesh::splitFace(int faceId, const BoundingBox3f &box, int dim,
+                     float position, BoundingBox3f &left,
+                     BoundingBox3f &right) const {
+  left.reset();
+  right.reset();
+  for (int i = 0; i < 3; ++i) {
+    const Point3f &p0 = vertexOfFace(faceId, i).position;
+    const Point3f &p1 = vertexOfFace(faceId, (i + 1) % 3).position;
+    if (p0[dim] <= position)
+      left.expandBy(p0);
+    if (p0[dim] >= position)
+      right.expandBy(p0);
+    // the edges crossing the plane add their intersection to both sides
+    if ((p0[dim] < position && p1[dim] > position) ||
+        (p0[dim] > position && p1[dim] < position)) {
+      float t = clamp((position - p0[dim]) / (p1[dim] - p0[dim]), 0.f, 1.f);
+      Point3f p = p0 + t * (p1 - p0);
+      p[dim] = position;
+      left.expandBy(p);
+      right.expandBy(p);
+    }
+  }
+  left.clip(box);
+  right.clip(box);
+}
+
+bool Mesh::intersectTriangle(const Ray &ray, const TriangleRecord &tri,
+                             float tMax, float &t, float &u, float &v) {
+  // Moller-Trumbore: solves o + t d = p0 + u e1 + v e2 with Cramer's rule
+  Vector3f pvec = ray.direction.cross(tri.e2);
+  float det = tri.e1.dot(pvec);
+  if (det == 0.f)
+    return false;
+  float invDet = 1.f / det;
+  Vector3f tvec = ray.origin - tri.p0;
+  u = tvec.dot(pvec) * invDet;
+  if (u < 0.f || u > 1.f)
+    return false;
+  Vector3f qvec = tvec.cross(tri.e1);
+  v = ray.direction.dot(qvec) * invDet;
+  if (v < 0.f || u + v > 1.f)
+    return false;
+  t = tri.e2.dot(qvec) * invDet;
+  return t >= ray.tMin && t < tMax && t <= ray.tMax;
+}
+
+template <int N> void Mesh::buildPacks(TrianglePackList<N> &packs) {
+  const std::vector<int> &faceIds = m_BVH->primitiveIds();
+  packs.resize(faceIds.size() / N);
+  tbb::parallel_for(
+      tbb::blocked_range<int>(0, packs.size()),
+      [&](const tbb::blocked_range<int> &range) {
+        for (int p = range.begin(); p < range.end(); ++p) {
+          for (int lane = 0; lane < N; ++lane) {
+            int faceId = faceIds[p * N + lane];
+            const Point3f &p0 = vertexOfFace(faceId, 0).position;
+            Vector3f e1 = vertexOfFace(faceId, 1).position - p0;
+            Vector3f e2 = vertexOfFace(faceId, 2).position - p0;
+            for (int dim = 0; dim < 3; ++dim) {
+              packs[p].p0[dim][lane] = p0[dim];
+              packs[p].e1[dim][lane] = e1[dim];
+              packs[p].e2[dim][lane] = e2[dim];
+            }
+          }
+        }
+      });
+}
+
+template <int N>
+int Mesh::intersectPack(const Ray &ray, const TrianglePack<N> &pack,
+                        float tMax, float &t, float &u, float &v) {
+  typedef typename TrianglePack<N>::Lanes Lanes;
+  const Vector3f &d = ray.direction;
+  // same computations as intersectTriangle(), on the N lanes at once
+  Lanes pvec[3] = {d[1] * pack.e2[2] - d[2] * pack.e2[1],
+                   d[2] * pack.e2[0] - d[0] * pack.e2[2],
+                   d[0] * pack.e2[1] - d[1] * pack.e2[0]};
+  Lanes det = pack.e1[0] * pvec[0] + pack.e1[1] * pvec[1] +
+              pack.e1[2] * pvec[2];
+  Lanes invDet = det.inverse();
+  Lanes tvec[3] = {ray.origin[0] - pack.p0[0], ray.origin[1] - pack.p0[1],
+                   ray.origin[2] - pack.p0[2]};
+  Lanes us = (tvec[0] * pvec[0] + tvec[1] * pvec[1] + tvec[2] * pvec[2]) *
+             invDet;
+  Lanes qvec[3] = {tvec[1] * pack.e1[2] - tvec[2] * pack.e1[1],
+                   tvec[2] * pack.e1[0] - tvec[0] * pack.e1[2],
+                   tvec[0] * pack.e1[1] - tvec[1] * pack.e1[0]};
+  Lanes vs = (d[0] * qvec[0] + d[1] * qvec[1] + d[2] * qvec[2]) * invDet;
+  Lanes ts = (pack.e2[0] * qvec[0] + pack.e2[1] * qvec[1] +
+              pack.e2[2] * qvec[2]) *
+             invDet;
+  Lanes hits = ((det != 0.f) && (us >= 0.f) && (vs >= 0.f) &&
+                (us + vs <= 1.f) && (ts >= ray.tMin) && (ts < tMax) &&
+                (ts <= ray.tMax))
+                   .select(ts, Lanes::Constant(
+                                   std::numeric_limits<float>::infinity()));
+  int lane;
+  t = hits.minCoeff(&lane);
+  if (t == std::numeric_limits<float>::infinity())
+    return -1;
+  u = us[lane];
+  v = vs[lane];
+  return lane;
+}
+
+template <int N>
+int Mesh::intersectPacks(const TrianglePackList<N> &packs, const Ray &ray,
+                         Hit &hit, float &u, float &v) const {
+  int hitTriangle = -1;
+  long int nbTested = 0;
+  m_BVH->intersectLeaves(ray, hit, [&](int first, int count) {
+    return intersectPackLeaf(packs, ray, hit, first, count, hitTriangle, u, v,
+                             nbTested);
+  });
+  RayStats::local().trianglesTested += nbTested;
+  return hitTriangle;
+}
+
+template <int N>
+bool Mesh::intersectPackLeaf(const TrianglePackList<N> &packs, const Ray &ray,
+                             Hit &hit, int first, int count, int &hitTriangle,
+                             float &u, float &v, long int &nbTested) const {
+  bool found = false;
+  for (int p = first / N; p * N < first + count; ++p) {
+    nbTested += N;
+    float t, pu, pv;
+    int lane = intersectPack(ray, packs[p], hit.t, t, pu, pv);
+    if (lane >= 0) {
+      hit.t = t;
+      hitTriangle = p * N + lane;
+      u = pu;
+      v = pv;
+      found = true;
+    }
+  }
+  return found;
+}
+
+bool Mesh::intersectTriangleLeaf(const Ray &ray, Hit &hit, int first,
+                                 int count, int &hitTriangle, float &u,
+                                 float &v, long int &nbTested) const {
+  bool found = false;
+  for (int i = first; i < first + count; ++i) {
+    ++nbTested;
+    float t, tu, tv;
+    if (intersectTriangle(ray, m_triangles[i], hit.t, t, tu, tv)) {
+      hit.t = t;
+      hitTriangle = i;
+      u = tu;
+      v = tv;
+      found = true;
+    }
+  }
+  return found;
+}
+
+template <int N>
+bool Mesh::occludedPacks(const TrianglePackList<N> &packs, const Ray &ray,
+                         float tMax) const {
+  long int nbTested = 0;
+  bool occluded =
+      m_BVH->occludedLeaves(ray, tMax, [&](int first, int count) {
+        for (int p = first / N; p * N < first + count; ++p) {
+          nbTested += N;
+          float t, u, v;
+          if (intersectPack(ray, packs[p], tMax, t, u, v) >= 0)
+            return true;
+        }
+        return false;
+      });
+  RayStats::local().trianglesTested += nbTested;
+  return occluded;
+}
+
+void Mesh::computeSurfaceInteraction(const Ray &ray, Hit &hit) const {
+  int faceId = hit.primitiveId;
+  float u = hit.barycentric.x(), v = hit.barycentric.y();
   const Vertex &v0 = vertexOfFace(faceId, 0);
   const Vertex &v1 = vertexOfFace(faceId, 1);
   const Vertex &v2 = vertexOfFace(faceId, 2);
-  Vector3f e1 = v1.position - v0.position;
-  Vector3f e2 = v2.position - v0.position;
-  Eigen::Matrix3f M;
-  M << -ray.direction, e1, e2;
-  Vector3f tuv = M.inverse() * (ray.origin - v0.position);
-  float t = tuv(0), u = tuv(1), v = tuv(2);
-  if (t > 0 && u >= 0 && v >= 0 && (u + v) <= 1 && t < hit.t) {
-    hit.t = t;
-
-    if (ray.shadowRay)
-      return true;
+  Vector3f n = u * v1.normal + v * v2.normal + (1. - u - v) * v0.normal;
+  hit.localFrame = Frame(n.normalized());
+  hit.uv = u * v1.texcoord + v * v2.texcoord + (1. - u - v) * v0.texcoord;
+}
 
-    Vector3f n = u * v1.normal + v * v2.normal +
-                 (1. - u - v) * v0.normal;
-    hit.localFrame = Frame(n.normalized());
-    hit.uv = u * v1.texcoord + v * v2.texcoord + (1. - u - v) * v0.texcoord;
+bool Mesh::intersectFace(const Ray &ray, Hit &hit, int faceId) const {
+  const Point3f &p0 = vertexOfFace(faceId, 0).position;
+  TriangleRecord tri = {p0, vertexOfFace(faceId, 1).position - p0,
+                        vertexOfFace(faceId, 2).position - p0};
+  float t, u, v;
+  if (!intersectTriangle(ray, tri, hit.t, t, u, v))
+    return false;
+  hit.t = t;
+  hit.primitiveId = faceId;
+  hit.barycentric = Point2f(u, v);
+  return true;
+}
 
+/** Queries of the BVH, whose leaves are tested one triangle record at a time
+ * or by packs of 4 or 8 depending on the leaf alignment. Only t, u, v and the
+ * triangle are kept during the traversals, the shading data are interpolated
+ * later for the closest hit. */
+class Mesh::BVHTriangleAccelerator : public TriangleAccelerator {
+public:
+  BVHTriangleAccelerator(const Mesh &mesh)
+      : m_mesh(mesh), m_bvh(*mesh.m_BVH),
+        m_packSize(mesh.m_bvhParams.leafAlignment) {}
+
+  bool intersect(const Ray &ray, Hit &hit) const {
+    int hitTriangle = -1;
+    float hitU, hitV;
+    if (m_packSize == 4) {
+      hitTriangle = m_mesh.intersectPacks(m_mesh.m_packs4, ray, hit, hitU,
+                                          hitV);
+    } else if (m_packSize == 8) {
+      hitTriangle = m_mesh.intersectPacks(m_mesh.m_packs8, ray, hit, hitU,
+                                          hitV);
+    } else {
+      long int nbTested = 0;
+      m_bvh.intersect(ray, hit, [&](int i) {
+        ++nbTested;
+        float t, u, v;
+        if (!intersectTriangle(ray, m_mesh.m_triangles[i], hit.t, t, u, v))
+          return false;
+        hit.t = t;
+        hitTriangle = i;
+        hitU = u;
+        hitV = v;
+        return true;
+      });
+      RayStats::local().trianglesTested += nbTested;
+    }
+    if (hitTriangle < 0)
+      return false;
+    hit.primitiveId = m_bvh.primitiveId(hitTriangle);
+    hit.barycentric = Point2f(hitU, hitV);
     return true;
   }
-  return false;
-}
 
-bool Mesh::intersect(const Ray &ray, Hit &hit) const {
-  if (m_BVH) {
-    // use the BVH !!
-    return m_BVH->intersect(ray, hit);
-  } else {
-    // brute force !!
+  void intersectPacket(const RayPacket &packet, uint32_t mask,
+                       Hit *hits) const {
+    // closest triangle of each ray, shaded later as in intersect()
+    int hitTriangle[RayPacket::MaxSize];
+    float hitU[RayPacket::MaxSize], hitV[RayPacket::MaxSize];
+    std::fill(hitTriangle, hitTriangle + packet.size, -1);
+    long int nbTested = 0;
+    m_bvh.intersectPacketLeaves(
+        packet, mask, hits, [&](int first, int count, uint32_t laneMask) {
+          for (int lane = 0; lane < packet.size; ++lane) {
+            if (!((laneMask >> lane) & 1))
+              continue;
+            const Ray &ray = packet.rays[lane];
+            if (m_packSize == 4)
+              m_mesh.intersectPackLeaf(m_mesh.m_packs4, ray, hits[lane],
+                                       first, count, hitTriangle[lane],
+                                       hitU[lane], hitV[lane], nbTested);
+            else if (m_packSize == 8)
+              m_mesh.intersectPackLeaf(m_mesh.m_packs8, ray, hits[lane],
+                                       first, count, hitTriangle[lane],
+                                       hitU[lane], hitV[lane], nbTested);
+            else
+              m_mesh.intersectTriangleLeaf(ray, hits[lane], first, count,
+                                           hitTriangle[lane], hitU[lane],
+                                           hitV[lane], nbTested);
+          }
+        });
+    RayStats::local().trianglesTested += nbTested;
+    for (int lane = 0; lane < packet.size; ++lane) {
+      if (hitTriangle[lane] < 0)
+        continue;
+      hits[lane].primitiveId = m_bvh.primitiveId(hitTriangle[lane]);
+      hits[lane].barycentric = Point2f(hitU[lane], hitV[lane]);
+    }
+  }
+
+  bool occluded(const Ray &ray, float tMax) const {
+    if (m_packSize == 4)
+      return m_mesh.occludedPacks(m_mesh.m_packs4, ray, tMax);
+    if (m_packSize == 8)
+      return m_mesh.occludedPacks(m_mesh.m_packs8, ray, tMax);
+    long int nbTested = 0;
+    bool occluded = m_bvh.occluded(ray, tMax, [&](int i) {
+      ++nbTested;
+      float t, u, v;
+      return intersectTriangle(ray, m_mesh.m_triangles[i], tMax, t, u, v);
+    });
+    RayStats::local().trianglesTested += nbTested;
+    return occluded;
+  }
+
+  void occludedStream(const Ray *rays, const int *ids, int count,
+                      bool *isOccluded) const {
+    long int nbTested = 0;
+    m_bvh.occludedStream(
+        rays, ids, count, isOccluded,
+        [&](int first, int nbFaces, const int *leafIds, int nbIds) {
+          for (int k = 0; k < nbIds; ++k) {
+            const Ray &ray = rays[leafIds[k]];
+            bool occluded = false;
+            float t, u, v;
+            if (m_packSize == 4 || m_packSize == 8) {
+              for (int p = first / m_packSize;
+                   p * m_packSize < first + nbFaces && !occluded; ++p) {
+                nbTested += m_packSize;
+                occluded = m_packSize == 4
+                               ? intersectPack(ray, m_mesh.m_packs4[p],
+                                               ray.tMax, t, u, v) >= 0
+                               : intersectPack(ray, m_mesh.m_packs8[p],
+                                               ray.tMax, t, u, v) >= 0;
+              }
+            } else {
+              for (int i = first; i < first + nbFaces && !occluded; ++i) {
+                ++nbTested;
+                occluded = intersectTriangle(ray, m_mesh.m_triangles[i],
+                                             ray.tMax, t, u, v);
+              }
+            }
+            if (occluded)
+              isOccluded[leafIds[k]] = true;
+          }
+        });
+    RayStats::local().trianglesTested += nbTested;
+  }
+
+private:
+  const Mesh &m_mesh;
+  const BVH &m_bvh;
+  int m_packSize;
+};
+
+/** Queries of the kd-tree, whose leaves are tested one triangle record at a
+ * time. It has no packet or stream traversal: the packets and streams are
+ * traced ray by ray. */
+class Mesh::KDTreeTriangleAccelerator : public TriangleAccelerator {
+public:
+  KDTreeTriangleAccelerator(const Mesh &mesh)
+      : m_mesh(mesh), m_kdtree(*mesh.m_kdtree) {}
+
+  bool intersect(const Ray &ray, Hit &hit) const {
+    // same deferred shading as with the BVH
+    int hitTriangle = -1;
+    float hitU, hitV;
+    long int nbTested = 0;
+    m_kdtree.intersect(ray, hit, [&](int i) {
+      ++nbTested;
+      float t, u, v;
+      if (!intersectTriangle(ray, m_mesh.m_triangles[i], hit.t, t, u, v))
+        return false;
+      hit.t = t;
+      hitTriangle = i;
+      hitU = u;
+      hitV = v;
+      return true;
+    });
+    RayStats::local().trianglesTested += nbTested;
+    if (hitTriangle < 0)
+      return false;
+    hit.primitiveId = m_kdtree.primitiveId(hitTriangle);
+    hit.barycentric = Point2f(hitU, hitV);
+    return true;
+  }
+
+  void intersectPacket(const RayPacket &packet, uint32_t mask,
+                       Hit *hits) const {
+    for (int lane = 0; lane < packet.size; ++lane) {
+      if ((mask >> lane) & 1)
+        intersect(packet.rays[lane], hits[lane]);
+    }
+  }
+
+  bool occluded(const Ray &ray, float tMax) const {
+    long int nbTested = 0;
+    bool occluded = m_kdtree.occluded(ray, tMax, [&](int i) {
+      ++nbTested;
+      float t, u, v;
+      return intersectTriangle(ray, m_mesh.m_triangles[i], tMax, t, u, v);
+    });
+    RayStats::local().trianglesTested += nbTested;
+    return occluded;
+  }
+
+  void occludedStream(const Ray *rays, const int *ids, int count,
+                      bool *isOccluded) const {
+    for (int k = 0; k < count; ++k) {
+      const Ray &ray = rays[ids[k]];
+      if (occluded(ray, ray.tMax))
+        isOccluded[ids[k]] = true;
+    }
+  }
+
+private:
+  const Mesh &m_mesh;
+  const KDTree &m_kdtree;
+};
+
+/** Brute force queries, testing every face of the mesh */
+class Mesh::BruteForceTriangleAccelerator : public TriangleAccelerator {
+public:
+  BruteForceTriangleAccelerator(const Mesh &mesh) : m_mesh(mesh) {}
+
+  bool intersect(const Ray &ray, Hit &hit) const {
     bool ret = false;
     float tMin, tMax;
-    if ((!m_AABB.rayIntersect(ray, tMin, tMax)) || tMin > hit.t)
+    if ((!m_mesh.m_AABB.rayIntersect(ray, tMin, tMax)) || tMin > hit.t)
       return false;
 
-    for (unsigned int i = 0; i < m_faces.size(); ++i) {
-      ret = ret | intersectFace(ray, hit, i);
+    long int nbTested = 0;
+    for (int i = 0; i < m_mesh.nbFaces(); ++i) {
+      ++nbTested;
+      ret = ret | m_mesh.intersectFace(ray, hit, i);
     }
+    RayStats::local().trianglesTested += nbTested;
     return ret;
   }
+
+  void intersectPacket(const RayPacket &packet, uint32_t mask,
+                       Hit *hits) const {
+    for (int lane = 0; lane < packet.size; ++lane) {
+      if ((mask >> lane) & 1)
+        intersect(packet.rays[lane], hits[lane]);
+    }
+  }
+
+  bool occluded(const Ray &ray, float tMax) const {
+    Ray shadowRay(ray);
+    shadowRay.shadowRay = true;
+    Hit hit;
+    hit.t = tMax;
+    return intersect(shadowRay, hit);
+  }
+
+  void occludedStream(const Ray *rays, const int *ids, int count,
+                      bool *isOccluded) const {
+    for (int k = 0; k < count; ++k) {
+      const Ray &ray = rays[ids[k]];
+      if (occluded(ray, ray.tMax))
+        isOccluded[ids[k]] = true;
+    }
+  }
+
+private:
+  const Mesh &m_mesh;
+};
+
+void Mesh::updateTriangleAccelerator() {
+  delete m_triangleAccelerator;
+  if (m_kdtree)
+    m_triangleAccelerator = new KDTreeTriangleAccelerator(*this);
+  else if (m_BVH)
+    m_triangleAccelerator = new BVHTriangleAccelerator(*this);
+  else
+    m_triangleAccelerator = new BruteForceTriangleAccelerator(*this);
+}
+
+bool Mesh::intersect(const Ray &ray, Hit &hit) const {
+  return m_triangleAccelerator->intersect(ray, hit);
+}
+
+void Mesh::intersectPacket(const RayPacket &packet, uint32_t mask,
+                           Hit *hits) const {
+  m_triangleAccelerator->intersectPacket(packet, mask, hits);
+}
+
+bool Mesh::occluded(const Ray &ray, float tMax) const {
+  return m_triangleAccelerator->occluded(ray, tMax);
+}
+
+void Mesh::occludedStream(const Ray *rays, const int *ids, int count,
+                          bool *isOccluded) const {
+  m_triangleAccelerator->occludedStream(rays, ids, count, isOccluded);
 }
 
 void Mesh::sample(const Point2f &sample, Point3f &p, Normal3f &n,
@@ -278,12 +1000,29 @@ void Mesh::sample(const Point2f &sample, Point3f &p, Normal3f &n,
 }
 
 std::string Mesh::toString() const {
+  // memory of the vertices and faces, and without shared vertices (one
+  // vertex per face corner)
+  size_t memory = m_vertices.size() * sizeof(Vertex) +
+                  m_faces.size() * sizeof(FaceIndex);
+  size_t unsharedMemory = m_faces.size() * (3 * sizeof(Vertex) +
+                                            sizeof(FaceIndex));
   return tfm::format("Mesh[\n"
+                     "  id = %s,\n"
                      "  vertexCount = %i,\n"
                      "  triangleCount = %i,\n"
+                     "  memory = %s (%s without shared vertices),\n"
+                     "  accelerator = %s,\n"
+                     "  BVH = %s (leaf size %i, width %i, leaf pack %i, "
+                     "quantization %i),\n"
                      "  BSDF = %s\n"
                      "]",
-                     m_vertices.size(), m_faces.size(),
+                     m_id.empty() ? std::string("none") : m_id,
+                     m_vertices.size(), m_faces.size(), memString(memory),
+                     memString(unsharedMemory),
+                     acceleratorName(m_accelerator),
+                     BVH::splitMethodName(m_bvhParams.splitMethod),
+                     m_bvhParams.targetCellSize, m_bvhParams.width,
+                     m_bvhParams.leafAlignment, m_bvhParams.quantization,
                      m_bsdf ? indent(m_bsdf->toString()) : std::string("null"));
 }
 
@@ -1,6 +1,8 @@
 #pragma once
 
+#include "accelerators/accelerator.h"
 #include "accelerators/bvh.h"
+#include "accelerators/kdtree.h"
 #include "common.h"
 #include "shape.h"
 #include "dpdf.h"
@@ -8,13 +10,13 @@
 #include <string>
 #include <vector>
 
+struct MeshFileContent;
+
 /** \class Mesh
  * A class to represent a 3D triangular mesh
  */
 class Mesh : public Shape {
 public:
-  static long int ms_itersection_count;
-
   /** Represents a vertex of the mesh */
   struct Vertex {
     Vertex()
@@ -32,8 +34,27 @@ public:
     Vector2f texcoord;
   };
 
+  /** Version of the conversion of the mesh files into faces (triangulation,
+   * order of the faces), part of the key of the cached BVHs: to increment
+   * whenever the faces loaded from a given file change */
+  static constexpr uint32_t LoaderVersion = 3;
+
   Mesh(const PropertyList &propList);
 
+  /** Merges the \a meshes, transformed to world space, into a single mesh
+   * whose BVH is built with \a params. Each face remembers the mesh it comes
+   * from, see sourceMesh(). */
+  Mesh(const std::vector<const Mesh *> &meshes,
+       const BVH::BuildParams &params);
+
+  /** \returns the BVH construction parameters given by the properties
+   * "bvhSplit", "bvhLeafSize", etc. */
+  static BVH::BuildParams bvhParams(const PropertyList &props);
+
+  /** \returns the kd-tree construction parameters given by the properties
+   * "kdIntersectCost", "kdLeafSize", etc. */
+  static KDTree::BuildParams kdtreeParams(const PropertyList &props);
+
   /** Destructor */
   virtual ~Mesh();
 
@@ -41,28 +62,87 @@ public:
 
   void loadFromFile(const std::string &filename);
 
-  /** Loads a triangular mesh in the OFF format */
+  /** Loads a mesh in the OFF format (see parseOFF()), whose polygons are
+   * triangulated */
   void loadOFF(const std::string &filename);
 
-  /** Loads a triangular mesh in the OBJ format */
+  /** Loads a mesh in the OBJ format (see parseOBJ()), whose polygons are
+   * triangulated. The face corners with the same position, normal and
+   * texture coordinates indices share a vertex. */
   void loadOBJ(const std::string &filename);
 
-  /** Compute the intersection between a ray and the mesh */
+  /** Compute the intersection between a ray and the mesh, with the
+   * accelerator built by buildAccelerator() */
   virtual bool intersect(const Ray &ray, Hit &hit) const;
 
-  /** Compute the intersection between a ray and a given triangular face */
+  /** Packet version of intersect(): the BVH is traversed by the whole
+   * packet, the kd-tree and the brute force trace the rays one by one */
+  virtual void intersectPacket(const RayPacket &packet, uint32_t mask,
+                               Hit *hits) const;
+
+  /** \returns true if any triangle is hit before \a tMax */
+  virtual bool occluded(const Ray &ray, float tMax) const;
+
+  /** Stream version of occluded(): the BVH is traversed by the whole stream
+   * (see BVH::occludedStream()), the kd-tree and the brute force test the
+   * rays one by one */
+  virtual void occludedStream(const Ray *rays, const int *ids, int count,
+                              bool *isOccluded) const;
+
+  /** Compute the intersection between a ray and a given triangular face.
+   * The test is not counted in the RayStats, the caller counts its tests. */
   bool intersectFace(const Ray &ray, Hit &hit, int faceId) const;
 
+  /** Interpolates the shading normal and texture coordinates of the face
+   * \a hit.primitiveId at the barycentric coordinates \a hit.barycentric */
+  virtual void computeSurfaceInteraction(const Ray &ray, Hit &hit) const;
+
   void makeUnitary();
+  /** Smooths the normals of the vertices without a normal in the file (see
+   * m_computedNormals) as the area-weighted average of the normals of their
+   * faces */
   void computeNormals();
   void computeBoundingBox();
+
+  /** Builds the acceleration structure selected by the property
+   * "accelerator": the BVH, the kd-tree, or none for the brute force */
+  void buildAccelerator();
+  /** Builds the acceleration structure unless it is already built. It is not
+   * built by the constructor: the scene skips the meshes it bakes (see
+   * Scene::updateBVH()), the other users of the mesh call this. */
+  void prepareAccelerator();
   void buildBVH();
+  void buildKDTree();
+
+  /** Updates the acceleration structure after the vertices moved: the BVH is
+   * refitted, or rebuilt if the refit degrades it too much (see
+   * BVH::update()), the kd-tree is rebuilt */
+  void updateBVH();
+
+  /** Moves the vertices to \a positions (one per vertex), recomputes the
+   * normals that were not read from the file, the area distribution and
+   * updates the BVH. The scene must then update its own hierarchy with
+   * Scene::updateBVH(). */
+  void setPositions(const std::vector<Point3f> &positions);
 
   /// \returns  the number of faces
   int nbFaces() const { return m_faces.size(); }
 
+  /// \returns the vertices, e.g. to compute new positions for setPositions()
+  const std::vector<Vertex> &vertices() const { return m_vertices; }
+
   virtual float area() const { return m_area; };
 
+  /** \returns the property <string name="id" value="..."/> by which the
+   * instances of the same scene reference the mesh, or an empty string */
+  const std::string &id() const { return m_id; }
+
+  /// \returns the mesh the face \a faceId was merged from, or this mesh
+  const Mesh *sourceMesh(int faceId) const {
+    return m_sourceMeshes.empty() ? this
+                                  : m_sourceMeshes[m_faceSources[faceId]];
+  }
+
   virtual void sample(const Point2f &sample, Point3f &p, Normal3f &n,
                       float &pdf) const;
 
@@ -79,7 +159,105 @@ public:
 
   BVH *bvh() { return m_BVH; }
 
+  /// \returns the BVH construction parameters, see bvhParams()
+  const BVH::BuildParams &buildParams() const { return m_bvhParams; }
+
+  /** \returns the mesh file, or an empty string once the positions no
+   * longer match it */
+  const std::string &filePath() const { return m_filePath; }
+
 protected:
+  /** Compact triangle used by the intersection kernel: its first vertex and
+   * its two edges, without the shading data */
+  struct TriangleRecord {
+    Point3f p0;
+    Vector3f e1, e2;
+  };
+
+  /** Moller-Trumbore ray/triangle test. \returns true if the ray hits the
+   * triangle in its interval and before \a tMax, with the distance \a t and
+   * the barycentric coordinates (\a u, \a v) of the second and third
+   * vertices. */
+  static bool intersectTriangle(const Ray &ray, const TriangleRecord &tri,
+                                float tMax, float &t, float &u, float &v);
+
+  /** Packs of N triangles in SoA layout, tested at once with SIMD
+   * instructions (the edges are given from the first vertex) */
+  template <int N> struct TrianglePack {
+    typedef Eigen::Array<float, N, 1> Lanes;
+    Lanes p0[3], e1[3], e2[3];
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  };
+
+  template <int N>
+  using TrianglePackList =
+      std::vector<TrianglePack<N>, Eigen::aligned_allocator<TrianglePack<N>>>;
+
+  /** Vectorized version of intersectTriangle(). \returns the lane of the
+   * closest hit before \a tMax, or -1 */
+  template <int N>
+  static int intersectPack(const Ray &ray, const TrianglePack<N> &pack,
+                           float tMax, float &t, float &u, float &v);
+
+  /** Builds the vertices and faces from the content of a mesh file, and the
+   * bounding box */
+  void setContent(const MeshFileContent &content);
+
+  /** Computes the area of the mesh and the distribution of its faces by area,
+   * sampled by sample() */
+  void computeAreaPDF();
+
+  /// \returns the bounds of the faces, indexed by face
+  std::vector<BoundingBox3f> computeFaceBounds() const;
+  /// \returns the clipping of the faces used by the spatial splits
+  BVH::PrimitiveSplitter faceSplitter() const;
+  /** Fills m_triangles or the packs from the leaf order of the BVH or of
+   * the kd-tree */
+  void buildTriangleRecords();
+  /** Replaces m_triangleAccelerator by the queries of the built BVH or
+   * kd-tree, or by the brute force */
+  void updateTriangleAccelerator();
+
+  /** Clips the part of the face \a faceId inside \a box by the plane of
+   * coordinate \a position along \a dim (spatial splits of the BVH) */
+  void splitFace(int faceId, const BoundingBox3f &box, int dim,
+                 float position, BoundingBox3f &left,
+                 BoundingBox3f &right) const;
+
+  /** Fills \a packs with the triangles in the leaf order of the BVH */
+  template <int N> void buildPacks(TrianglePackList<N> &packs);
+
+  /** Traverses the BVH and tests the packs of the visited leaves. \returns
+   * the position of the closest triangle in the leaf order, or -1 */
+  template <int N>
+  int intersectPacks(const TrianglePackList<N> &packs, const Ray &ray,
+                     Hit &hit, float &u, float &v) const;
+
+  /** Tests the ray against the packs of the leaf [first, first+count) of the
+   * BVH, and records a closer hit in \a hit.t, \a hitTriangle (position in
+   * the leaf order), \a u and \a v. \a nbTested counts the tested
+   * triangles. \returns true if a closer hit was found. */
+  template <int N>
+  bool intersectPackLeaf(const TrianglePackList<N> &packs, const Ray &ray,
+                         Hit &hit, int first, int count, int &hitTriangle,
+                         float &u, float &v, long int &nbTested) const;
+
+  /// Same as intersectPackLeaf(), for the triangles of m_triangles
+  bool intersectTriangleLeaf(const Ray &ray, Hit &hit, int first, int count,
+                             int &hitTriangle, float &u, float &v,
+                             long int &nbTested) const;
+
+  /// Any hit version of intersectPacks()
+  template <int N>
+  bool occludedPacks(const TrianglePackList<N> &packs, const Ray &ray,
+                     float tMax) const;
+
+  /** The TriangleAccelerator of each acceleration structure, over the
+   * triangle records of the mesh (see mesh.cpp) */
+  class BVHTriangleAccelerator;
+  class KDTreeTriangleAccelerator;
+  class BruteForceTriangleAccelerator;
+
   /** Represent a triangular face via its 3 vertex indices. */
   typedef Eigen::Vector3i FaceIndex;
 
@@ -89,10 +267,28 @@ protected:
   /** Represents a sequential list of triangles */
   typedef std::vector<FaceIndex> FaceIndexArray;
 
+  /** Identifier of the mesh for the instances (see Instance) */
+  std::string m_id;
+
+  /** For the merged meshes, the source meshes and the index of the source of
+   * each face */
+  std::vector<const Mesh *> m_sourceMeshes;
+  std::vector<uint32_t> m_faceSources;
+
+  /** The mesh file, empty once the positions were modified: the BVH is
+   * cached only when it matches the content of this file */
+  std::string m_filePath;
+
   /** The list of vertices */
   VertexArray m_vertices;
   /** The list of face indices */
   FaceIndexArray m_faces;
+  /** The positions of the faces, in the leaf order of the BVH or of the
+   * kd-tree, either one by one or by packs of 4 or 8 depending on the leaf
+   * alignment of the BVH */
+  std::vector<TriangleRecord> m_triangles;
+  TrianglePackList<4> m_packs4;
+  TrianglePackList<8> m_packs8;
 
   /** The bounding box of the mesh */
   BoundingBox3f m_AABB;
@@ -100,8 +296,24 @@ protected:
   /** Area of the mesh **/
   float m_area;
 
+  /** Per vertex, true if its normal is computed by computeNormals(), false
+   * if it was read from the file */
+  std::vector<bool> m_computedNormals;
+
+  /** Acceleration structure, see buildAccelerator() */
+  EAccelerator m_accelerator = EBVHAccelerator;
+  bool m_acceleratorBuilt = false;
+  /** Queries of the built acceleration structure, the brute force until it
+   * is built */
+  TriangleAccelerator *m_triangleAccelerator = nullptr;
+
   /** Bounding Volume Hierarchy **/
   BVH *m_BVH;
+  BVH::BuildParams m_bvhParams;
+
+  /** kd-tree, used instead of the BVH if selected **/
+  KDTree *m_kdtree = nullptr;
+  KDTree::BuildParams m_kdtreeParams;
 
   DiscretePDF m_PDF;
 };
@@ -0,0 +1,530 @@
+#include "shapes/meshparser.h"
+#include "mappedfile.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <tbb/parallel_for.h>
+
+typedef MeshFileContent::Corner Corner;
+
+/* Size of the chunks parsed by a task: large enough for the allocations and
+ * the concatenation to be negligible, small enough to balance the load */
+static const size_t ChunkSize = 1 << 20;
+
+static bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+static const char *skipBlanks(const char *p, const char *end) {
+  while (p < end && isBlank(*p))
+    ++p;
+  return p;
+}
+
+/// \returns the end of the line starting at \a p: its '\n', or \a end
+static const char *lineEnd(const char *p, const char *end) {
+  const char *eol = static_cast<const char *>(std::memchr(p, '\n', end - p));
+  return eol ? eol : end;
+}
+
+/** Splits [begin, end) into chunks of about ChunkSize bytes made of whole
+ * lines. \returns the bounds of the chunks: the i-th one is
+ * [bounds[i], bounds[i + 1]). */
+static std::vector<const char *> splitLines(const char *begin,
+                                            const char *end) {
+  size_t nbChunks = std::max<size_t>(1, (end - begin) / ChunkSize);
+  std::vector<const char *> bounds(nbChunks + 1);
+  bounds[0] = begin;
+  for (size_t i = 1; i < nbChunks; ++i) {
+    const char *p =
+        std::max(begin + i * ((end - begin) / nbChunks), bounds[i - 1]);
+    const char *eol = lineEnd(p, end);
+    bounds[i] = eol < end ? eol + 1 : end;
+  }
+  bounds[nbChunks] = end;
+  return bounds;
+}
+
+/** Calls \a parseLine(begin, end) for the lines of [begin, end), without
+ * their '\n', until it returns false */
+template <typename LineParser>
+static void forEachLine(const char *begin, const char *end,
+                        const LineParser &parseLine) {
+  while (begin < end) {
+    const char *eol = lineEnd(begin, end);
+    if (!parseLine(begin, eol))
+      return;
+    begin = eol + 1;
+  }
+}
+
+/** Reads the number at \a p, after blanks, and moves \a p past it.
+ * \returns false, leaving \a p unchanged, if there is none. */
+static bool parseFloat(const char *&p, const char *end, float &value) {
+  const char *start = skipBlanks(p, end);
+  // from_chars does not accept the explicit positive sign
+  if (start < end && *start == '+')
+    ++start;
+  std::from_chars_result result = std::from_chars(start, end, value);
+  if (result.ec == std::errc::result_out_of_range) {
+    // value is left unchanged: strtof rounds it to 0 or to the infinity
+    char buffer[64];
+    size_t length = std::min<size_t>(result.ptr - start, sizeof(buffer) - 1);
+    std::memcpy(buffer, start, length);
+    buffer[length] = '\0';
+    value = std::strtof(buffer, nullptr);
+  } else if (result.ec != std::errc()) {
+    return false;
+  }
+  p = result.ptr;
+  return true;
+}
+
+static bool parseFloats(const char *&p, const char *end, float *values,
+                        int count) {
+  for (int i = 0; i < count; ++i) {
+    if (!parseFloat(p, end, values[i]))
+      return false;
+  }
+  return true;
+}
+
+static bool parseInt(const char *&p, const char *end, int &value) {
+  const char *start = skipBlanks(p, end);
+  std::from_chars_result result = std::from_chars(start, end, value);
+  if (result.ec != std::errc())
+    return false;
+  p = result.ptr;
+  return true;
+}
+
+/** Appends the fan of triangles of \a polygon to \a corners, recording the
+ * quads in \a quads (see splitQuad()) */
+static void triangulate(const std::vector<Corner> &polygon,
+                        std::vector<Corner> &corners, std::vector<int> &quads) {
+  if (polygon.size() == 4)
+    quads.push_back(corners.size());
+  for (size_t i = 1; i + 1 < polygon.size(); ++i) {
+    corners.push_back(polygon[0]);
+    corners.push_back(polygon[i]);
+    corners.push_back(polygon[i + 1]);
+  }
+}
+
+/** Splits the quad triangulated as a fan at \a corners along its shorter
+ * diagonal, once the positions are known */
+static void splitQuad(const std::vector<Point3f> &positions,
+                      Corner *corners) {
+  Corner quad[4] = {corners[0], corners[1], corners[2], corners[5]};
+  Vector3f e02 = positions[quad[2].position] - positions[quad[0].position];
+  Vector3f e13 = positions[quad[3].position] - positions[quad[1].position];
+  if (e02.squaredNorm() < e13.squaredNorm())
+    return;
+  const int split[6] = {0, 1, 3, 1, 2, 3};
+  for (int i = 0; i < 6; ++i)
+    corners[i] = quad[split[i]];
+}
+
+namespace {
+
+/// Attributes and faces of a chunk of an OBJ file
+struct ObjChunk {
+  std::vector<Point3f> positions;
+  std::vector<Vector2f> texcoords;
+  std::vector<Normal3f> normals;
+  std::vector<Corner> corners;
+  /** Corners with negative indices in the file, and masks of their
+   * attributes (1: position, 2: texcoord, 4: normal) whose index is relative
+   * to the start of the chunk rather than absolute */
+  std::vector<std::pair<int, int>> relativeCorners;
+  /// First corners of the triangles of the quads
+  std::vector<int> quads;
+  BoundingBox3f bbox;
+  /// First malformed line, if any
+  std::string error;
+};
+
+/// Position of an ObjChunk in the concatenated arrays
+struct ObjOffsets {
+  int positions = 0, texcoords = 0, normals = 0, corners = 0;
+};
+
+/// Faces of a chunk of an OFF file, whose vertices are written in place
+struct OffChunk {
+  std::vector<Corner> corners;
+  std::vector<int> quads;
+  BoundingBox3f bbox;
+  std::string error;
+};
+
+} // namespace
+
+/** Reads the OBJ index at \a p of an attribute of which \a count were read
+ * before it in the chunk. Positive indices are 1-based and made 0-based.
+ * Negative ones count back from the last attribute read: they are made
+ * relative to the start of the chunk, and \a relative is set. */
+static bool parseIndex(const char *&p, const char *end, int count, int &index,
+                       bool &relative) {
+  std::from_chars_result result = std::from_chars(p, end, index);
+  if (result.ec != std::errc() || index == 0)
+    return false;
+  p = result.ptr;
+  relative = index < 0;
+  index = relative ? count + index : index - 1;
+  return true;
+}
+
+/// Reads the corners "v", "v/vt", "v//vn" or "v/vt/vn" of an OBJ face
+static bool parseFace(const char *p, const char *end, ObjChunk &chunk,
+                      std::vector<Corner> &polygon, std::vector<int> &masks) {
+  polygon.clear();
+  masks.clear();
+  // until the end of the line or a trailing comment
+  while ((p = skipBlanks(p, end)) < end && *p != '#') {
+    Corner corner = {-1, -1, -1};
+    int mask = 0;
+    bool relative;
+    if (!parseIndex(p, end, chunk.positions.size(), corner.position,
+                    relative))
+      return false;
+    mask |= relative ? 1 : 0;
+    if (p < end && *p == '/') {
+      ++p;
+      if (p < end && *p != '/') {
+        if (!parseIndex(p, end, chunk.texcoords.size(), corner.texcoord,
+                        relative))
+          return false;
+        mask |= relative ? 2 : 0;
+      }
+      if (p < end && *p == '/') {
+        ++p;
+        if (!parseIndex(p, end, chunk.normals.size(), corner.normal,
+                        relative))
+          return false;
+        mask |= relative ? 4 : 0;
+      }
+    }
+    if (p < end && !isBlank(*p))
+      return false;
+    polygon.push_back(corner);
+    masks.push_back(mask);
+  }
+  if (polygon.size() < 3)
+    return false;
+  if (polygon.size() == 4)
+    chunk.quads.push_back(chunk.corners.size());
+  for (size_t i = 1; i + 1 < polygon.size(); ++i) {
+    for (size_t j : {size_t(0), i, i + 1}) {
+      if (masks[j])
+        chunk.relativeCorners.emplace_back(chunk.corners.size(), masks[j]);
+      chunk.corners.push_back(polygon[j]);
+    }
+  }
+  return true;
+}
+
+/** \returns true if the line [p, eol) starts with the OBJ statement
+ * \a keyword, e.g. "vt" */
+static bool isStatement(const char *p, const char *eol, const char *keyword) {
+  size_t length = std::strlen(keyword);
+  return size_t(eol - p) > length && std::memcmp(p, keyword, length) == 0 &&
+         isBlank(p[length]);
+}
+
+static void parseOBJChunk(const char *begin, const char *end,
+                          ObjChunk &chunk) {
+  std::vector<Corner> polygon;
+  std::vector<int> masks;
+  forEachLine(begin, end, [&](const char *line, const char *eol) {
+    const char *p = skipBlanks(line, eol);
+    bool valid = true;
+    if (isStatement(p, eol, "v")) {
+      Point3f position;
+      p += 1;
+      valid = parseFloats(p, eol, position.data(), 3);
+      chunk.positions.push_back(position);
+      chunk.bbox.expandBy(position);
+    } else if (isStatement(p, eol, "vt")) {
+      // the second coordinate is optional
+      Vector2f texcoord = Vector2f::Zero();
+      p += 2;
+      valid = parseFloat(p, eol, texcoord[0]);
+      parseFloat(p, eol, texcoord[1]);
+      chunk.texcoords.push_back(texcoord);
+    } else if (isStatement(p, eol, "vn")) {
+      Normal3f normal;
+      p += 2;
+      valid = parseFloats(p, eol, normal.data(), 3);
+      chunk.normals.push_back(normal);
+    } else if (isStatement(p, eol, "f")) {
+      valid = parseFace(p + 1, eol, chunk, polygon, masks);
+    }
+    if (!valid)
+      chunk.error.assign(line, eol);
+    return valid;
+  });
+}
+
+void parseOBJ(const std::string &filename, MeshFileContent &content) {
+  MappedFile file(filename);
+  if (!file.valid())
+    throw RTException("Unable to read the mesh file \"%s\"", filename);
+  std::vector<const char *> bounds =
+      splitLines(file.data(), file.data() + file.size());
+  int nbChunks = bounds.size() - 1;
+  std::vector<ObjChunk> chunks(nbChunks);
+  tbb::parallel_for(0, nbChunks, [&](int i) {
+    parseOBJChunk(bounds[i], bounds[i + 1], chunks[i]);
+  });
+
+  std::vector<ObjOffsets> offsets(nbChunks + 1);
+  content.bbox.reset();
+  for (int i = 0; i < nbChunks; ++i) {
+    const ObjChunk &chunk = chunks[i];
+    if (!chunk.error.empty())
+      throw RTException("Mesh: invalid line \"%s\" in \"%s\"", chunk.error,
+                        filename);
+    offsets[i + 1].positions = offsets[i].positions + chunk.positions.size();
+    offsets[i + 1].texcoords = offsets[i].texcoords + chunk.texcoords.size();
+    offsets[i + 1].normals = offsets[i].normals + chunk.normals.size();
+    offsets[i + 1].corners = offsets[i].corners + chunk.corners.size();
+    content.bbox.expandBy(chunk.bbox);
+  }
+  const ObjOffsets &total = offsets[nbChunks];
+  content.positions.resize(total.positions);
+  content.texcoords.resize(total.texcoords);
+  content.normals.resize(total.normals);
+  content.corners.resize(total.corners);
+
+  // concatenation, resolution of the relative indices and validation
+  std::vector<char> outOfRange(nbChunks, false);
+  tbb::parallel_for(0, nbChunks, [&](int i) {
+    ObjChunk &chunk = chunks[i];
+    const ObjOffsets &offset = offsets[i];
+    std::copy(chunk.positions.begin(), chunk.positions.end(),
+              content.positions.begin() + offset.positions);
+    std::copy(chunk.texcoords.begin(), chunk.texcoords.end(),
+              content.texcoords.begin() + offset.texcoords);
+    std::copy(chunk.normals.begin(), chunk.normals.end(),
+              content.normals.begin() + offset.normals);
+    Corner *corners = content.corners.data() + offset.corners;
+    std::copy(chunk.corners.begin(), chunk.corners.end(), corners);
+    /* a relative index before the first attribute is out of range, even
+       if it resolves to -1 as the absent attributes */
+    for (const std::pair<int, int> &relative : chunk.relativeCorners) {
+      Corner &corner = corners[relative.first];
+      if (relative.second & 1)
+        corner.position += offset.positions;
+      if (relative.second & 2) {
+        corner.texcoord += offset.texcoords;
+        outOfRange[i] |= corner.texcoord < 0;
+      }
+      if (relative.second & 4) {
+        corner.normal += offset.normals;
+        outOfRange[i] |= corner.normal < 0;
+      }
+    }
+    for (size_t j = 0; j < chunk.corners.size(); ++j) {
+      const Corner &corner = corners[j];
+      if (corner.position < 0 || corner.position >= total.positions ||
+          corner.texcoord < -1 || corner.texcoord >= total.texcoords ||
+          corner.normal < -1 || corner.normal >= total.normals)
+        outOfRange[i] = true;
+    }
+  });
+  if (std::find(outOfRange.begin(), outOfRange.end(), true) !=
+      outOfRange.end())
+    throw RTException("Mesh: face index out of range in \"%s\"", filename);
+  tbb::parallel_for(0, nbChunks, [&](int i) {
+    for (int quad : chunks[i].quads)
+      splitQuad(content.positions,
+                content.corners.data() + offsets[i].corners + quad);
+  });
+}
+
+/// \returns true if the OFF line [p, eol) is a record: not blank nor comment
+static bool isOFFRecord(const char *p, const char *eol) {
+  p = skipBlanks(p, eol);
+  return p < eol && *p != '#';
+}
+
+/// Skips the blanks, the line breaks and the comments of an OFF file
+static const char *skipOFFSpaces(const char *p, const char *end) {
+  while (p < end && (isBlank(*p) || *p == '\n' || *p == '#')) {
+    if (*p == '#')
+      p = lineEnd(p, end);
+    else
+      ++p;
+  }
+  return p;
+}
+
+/** Reads the OFF record \a record at \a p, a vertex or a face, whose values
+ * are separated by \a skip (the blanks only, or the line breaks too).
+ * \returns false if it is malformed. */
+template <typename Skip>
+static bool parseOFFRecord(const char *&p, const char *end, int record,
+                           int nbVertices, const Skip &skip,
+                           MeshFileContent &content, OffChunk &chunk,
+                           std::vector<Corner> &polygon) {
+  if (record < nbVertices) {
+    Point3f &position = content.positions[record];
+    for (int i = 0; i < 3; ++i) {
+      p = skip(p, end);
+      if (!parseFloat(p, end, position[i]))
+        return false;
+    }
+    chunk.bbox.expandBy(position);
+    return true;
+  }
+  int nbCorners;
+  p = skip(p, end);
+  if (!parseInt(p, end, nbCorners) || nbCorners < 3)
+    return false;
+  polygon.clear();
+  for (int i = 0; i < nbCorners; ++i) {
+    Corner corner = {-1, -1, -1};
+    p = skip(p, end);
+    if (!parseInt(p, end, corner.position) || corner.position < 0 ||
+        corner.position >= nbVertices)
+      return false;
+    polygon.push_back(corner);
+  }
+  triangulate(polygon, chunk.corners, chunk.quads);
+  return true;
+}
+
+/** Reads the records of a chunk of an OFF file, of which \a firstRecord
+ * precede it, one per line */
+static void parseOFFChunk(const char *begin, const char *end, int firstRecord,
+                          int nbVertices, int nbFaces,
+                          MeshFileContent &content, OffChunk &chunk) {
+  std::vector<Corner> polygon;
+  int record = firstRecord;
+  forEachLine(begin, end, [&](const char *line, const char *eol) {
+    if (!isOFFRecord(line, eol))
+      return true;
+    const char *p = line;
+    bool valid = record >= nbVertices + nbFaces ||
+                 parseOFFRecord(p, eol, record, nbVertices, skipBlanks,
+                                content, chunk, polygon);
+    ++record;
+    if (!valid)
+      chunk.error.assign(line, eol);
+    return valid;
+  });
+}
+
+/** Reads the records of an OFF file in one pass, which may be wrapped over
+ * several lines */
+static void parseWrappedOFF(const std::string &filename, const char *p,
+                            const char *end, int nbVertices, int nbFaces,
+                            MeshFileContent &content, OffChunk &chunk) {
+  std::vector<Corner> polygon;
+  for (int record = 0; record < nbVertices + nbFaces; ++record) {
+    const char *start = p = skipOFFSpaces(p, end);
+    if (p == end)
+      throw RTException("Mesh: \"%s\" has %i records for %i vertices and "
+                        "%i faces",
+                        filename, record, nbVertices, nbFaces);
+    if (!parseOFFRecord(p, end, record, nbVertices, skipOFFSpaces, content,
+                        chunk, polygon)) {
+      chunk.error.assign(start, lineEnd(p, end));
+      return;
+    }
+    // a record ends its line, e.g. the colors of a face are ignored
+    p = lineEnd(p, end);
+  }
+}
+
+/** Reads the records of an OFF file, one per line, in parallel chunks.
+ * \returns false if some record is not on a line of its own, the file must
+ * then be read by parseWrappedOFF() */
+static bool parseOFFLines(const char *begin, const char *end, int nbVertices,
+                          int nbFaces, MeshFileContent &content,
+                          std::vector<OffChunk> &chunks) {
+  /* the chunks are first scanned for their number of records, to know
+     whether their lines are vertices or faces */
+  std::vector<const char *> bounds = splitLines(begin, end);
+  int nbChunks = bounds.size() - 1;
+  std::vector<int> firstRecords(nbChunks + 1, 0);
+  tbb::parallel_for(0, nbChunks, [&](int i) {
+    int nbRecords = 0;
+    forEachLine(bounds[i], bounds[i + 1],
+                [&](const char *line, const char *eol) {
+                  nbRecords += isOFFRecord(line, eol);
+                  return true;
+                });
+    firstRecords[i + 1] = nbRecords;
+  });
+  for (int i = 0; i < nbChunks; ++i)
+    firstRecords[i + 1] += firstRecords[i];
+  if (firstRecords[nbChunks] < nbVertices + nbFaces)
+    return false;
+
+  chunks.resize(nbChunks);
+  tbb::parallel_for(0, nbChunks, [&](int i) {
+    parseOFFChunk(bounds[i], bounds[i + 1], firstRecords[i], nbVertices,
+                  nbFaces, content, chunks[i]);
+  });
+  for (const OffChunk &chunk : chunks) {
+    if (!chunk.error.empty())
+      return false;
+  }
+  return true;
+}
+
+void parseOFF(const std::string &filename, MeshFileContent &content) {
+  MappedFile file(filename);
+  if (!file.valid())
+    throw RTException("Unable to read the mesh file \"%s\"", filename);
+  const char *p = file.data(), *end = file.data() + file.size();
+
+  // header: "OFF", then the numbers of vertices, faces and edges
+  p = skipOFFSpaces(p, end);
+  const char *keyword = p;
+  while (p < end && !isBlank(*p) && *p != '\n')
+    ++p;
+  if (std::string(keyword, p) != "OFF")
+    throw RTException("Mesh: \"%s\" is not an OFF file (header \"%s\")",
+                      filename, std::string(keyword, p));
+  int counts[3];
+  for (int &count : counts) {
+    p = skipOFFSpaces(p, end);
+    if (!parseInt(p, end, count) || count < 0)
+      throw RTException("Mesh: invalid header in \"%s\"", filename);
+  }
+  int nbVertices = counts[0], nbFaces = counts[1];
+  p = lineEnd(p, end);
+
+  content.positions.resize(nbVertices);
+  content.texcoords.clear();
+  content.normals.clear();
+  /* Most files have one record per line, read in parallel. Otherwise the
+     records are read again in one pass, across the lines: the same values
+     are then read for the records on a line of their own. */
+  std::vector<OffChunk> chunks;
+  if (!parseOFFLines(p, end, nbVertices, nbFaces, content, chunks)) {
+    chunks.assign(1, OffChunk());
+    parseWrappedOFF(filename, p, end, nbVertices, nbFaces, content,
+                    chunks[0]);
+  }
+  int nbChunks = chunks.size();
+
+  std::vector<int> offsets(nbChunks + 1, 0);
+  content.bbox.reset();
+  for (int i = 0; i < nbChunks; ++i) {
+    if (!chunks[i].error.empty())
+      throw RTException("Mesh: invalid record \"%s\" in \"%s\"",
+                        chunks[i].error, filename);
+    offsets[i + 1] = offsets[i] + chunks[i].corners.size();
+    content.bbox.expandBy(chunks[i].bbox);
+  }
+  content.corners.resize(offsets[nbChunks]);
+  tbb::parallel_for(0, nbChunks, [&](int i) {
+    Corner *corners = content.corners.data() + offsets[i];
+    std::copy(chunks[i].corners.begin(), chunks[i].corners.end(), corners);
+    for (int quad : chunks[i].quads)
+      splitQuad(content.positions, corners + quad);
+  });
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "accelerators/bbox.h"
+#include "common.h"
+
+#include <string>
+#include <vector>
+
+/** \struct MeshFileContent
+ * Attributes and triangles read from a mesh file by parseOBJ() or
+ * parseOFF().
+ *
+ * The file is memory-mapped and split into chunks of whole lines, which are
+ * parsed in parallel into separate arrays, then concatenated in parallel.
+ * The numbers are read with std::from_chars, without going through the
+ * locale nor the streams.
+ */
+struct MeshFileContent {
+  /// Indices of the attributes of a face corner, -1 when absent
+  struct Corner {
+    int position;
+    int texcoord;
+    int normal;
+  };
+
+  std::vector<Point3f> positions;
+  std::vector<Vector2f> texcoords;
+  std::vector<Normal3f> normals;
+  /** Corners of the triangles, 3 per triangle. The quads are split along
+   * their shorter diagonal, the other polygons into fans of triangles around
+   * their first corner. */
+  std::vector<Corner> corners;
+  /// Bounding box of the positions
+  BoundingBox3f bbox;
+
+  int nbTriangles() const { return corners.size() / 3; }
+};
+
+/** Reads the positions, texture coordinates, normals and faces of the OBJ
+ * file \a filename, with their indices made 0-based and absolute. The other
+ * statements (groups, materials, lines, ...) are ignored.
+ * \throws RTException if the file cannot be read or is malformed */
+void parseOBJ(const std::string &filename, MeshFileContent &content);
+
+/** Reads the vertices and faces of the OFF file \a filename. The records are
+ * read in parallel when they are one per line, as written by the usual
+ * exporters, otherwise sequentially: a record may then be wrapped over
+ * several lines, but the values after it on its last line are ignored (e.g.
+ * the colors of the faces). The corners only have a position.
+ * \throws RTException if the file cannot be read or is malformed */
+void parseOFF(const std::string &filename, MeshFileContent &content);
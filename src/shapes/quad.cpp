@@ -9,36 +9,53 @@ Quad::Quad(const PropertyList &propList) {
   } catch (const RTException &e) {
     m_infinite = true;
   }
+  if (m_infinite) {
+    float inf = std::numeric_limits<float>::infinity();
+    m_AABB = BoundingBox3f(Point3f(-inf, -inf, 0.f), Point3f(inf, inf, 0.f));
+  } else {
+    m_AABB = BoundingBox3f(Point3f(-0.5f * m_size.x(), -0.5f * m_size.y(), 0.f),
+                           Point3f(0.5f * m_size.x(), 0.5f * m_size.y(), 0.f));
+  }
 }
 
-bool Quad::intersect(const Ray &ray, Hit &hit) const {
+bool Quad::intersectDistance(const Ray &ray, float tMax, float &t) const {
   // dot product close to zero => ray parallel to the plane
   if (ray.direction.z() == 0.f) 
     return false;
 
-  float t = -ray.origin.z() / ray.direction.z();
-
-  if (t <= 0.f)
+  t = -ray.origin.z() / ray.direction.z();
+  if (t < ray.tMin || t > std::min(tMax, ray.tMax))
     return false;
 
   Point3f pos = ray.at(t);
-  float u = pos.dot(Vector3f::UnitX());
-  float v = pos.dot(Vector3f::UnitY());
-  if (!m_infinite && (u < -m_size[0] * 0.5f || v < -m_size[1] * 0.5f ||
-                      u > m_size[0] * 0.5f || v > m_size[1] * 0.5f))
-    return false;
+  return m_infinite ||
+         (std::abs(pos.x()) <= m_size[0] * 0.5f &&
+          std::abs(pos.y()) <= m_size[1] * 0.5f);
+}
+
+bool Quad::occluded(const Ray &ray, float tMax) const {
+  float t;
+  return intersectDistance(ray, tMax, t);
+}
 
+bool Quad::intersect(const Ray &ray, Hit &hit) const {
+  float t;
+  if (!intersectDistance(ray, hit.t, t))
+    return false;
   hit.t = t;
-  
-  if (ray.shadowRay)
-      return true;
+  return true;
+}
+
+void Quad::computeSurfaceInteraction(const Ray &ray, Hit &hit) const {
+  Point3f pos = ray.at(hit.t);
+  float u = pos.x();
+  float v = pos.y();
 
   hit.localFrame = Frame(Normal3f(0.0, 0.0, 1.0));
   if (m_infinite)
     hit.uv = Point2f(pos.x(), pos.y());
   else
     hit.uv = Point2f(u / m_size[0] + 0.5f, v / m_size[1] + 0.5f);
-  return true;
 }
 
 void Quad::sample(const Point2f &sample, Point3f &p, Normal3f &n,
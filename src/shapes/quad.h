@@ -11,7 +11,12 @@ public:
 
   Vector2f size() const { return m_size; }
 
+  /// The bounding box of an infinite quad is unbounded along X and Y
+  virtual const BoundingBox3f &getBoundingBox() const { return m_AABB; }
+
   virtual bool intersect(const Ray &ray, Hit &hit) const;
+  virtual bool occluded(const Ray &ray, float tMax) const;
+  virtual void computeSurfaceInteraction(const Ray &ray, Hit &hit) const;
 
   virtual void sample(const Point2f &sample, Point3f &p, Normal3f &n,
                       float &pdf) const;
@@ -31,6 +36,10 @@ public:
   }
 
 protected:
+  /// Computes the distance \a t of the hit, if it is lower than \a tMax
+  bool intersectDistance(const Ray &ray, float tMax, float &t) const;
+
   Vector2f m_size;
   bool m_infinite;
+  BoundingBox3f m_AABB;
 };
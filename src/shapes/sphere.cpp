@@ -1,45 +1,64 @@
 #include "sphere.h"
 #include "warp.h"
 
-Sphere::Sphere(float radius) : m_radius(radius) {}
+Sphere::Sphere(float radius)
+    : m_radius(radius),
+      m_AABB(Point3f(-radius, -radius, -radius), Point3f(radius, radius, radius)) {}
 
 Sphere::Sphere(const PropertyList &propList) {
   m_radius = propList.getFloat("radius", 1.f);
   m_transformation = propList.getTransform("toWorld", Transform());
+  m_AABB = BoundingBox3f(Point3f(-m_radius, -m_radius, -m_radius),
+                         Point3f(m_radius, m_radius, m_radius));
+}
+
+bool Sphere::intersectDistance(const Ray &ray, float tMax, float &t) const {
+  // The direction is not normalized in object space: solve a.t^2 - 2b.t + c = 0
+  // computing the discriminant from the point of the ray closest to the center,
+  // which stays accurate when the origin is far away from the sphere.
+  float a = ray.direction.squaredNorm();
+  float b = -ray.direction.dot(ray.origin);
+  Vector3f f = ray.origin + (b / a) * ray.direction;
+  float discr = a * (m_radius * m_radius - f.squaredNorm());
+  if (discr < 0)
+    return false;
+  float q = b + std::copysign(std::sqrt(discr), b);
+  float c = ray.origin.squaredNorm() - m_radius * m_radius;
+  float t0 = c / q, t1 = q / a;
+  if (t0 > t1)
+    std::swap(t0, t1);
+  t = t0;
+  if (t < ray.tMin)
+    t = t1;
+  return t >= ray.tMin && t <= std::min(tMax, ray.tMax);
+}
+
+bool Sphere::occluded(const Ray &ray, float tMax) const {
+  float t;
+  return intersectDistance(ray, tMax, t);
 }
 
 bool Sphere::intersect(const Ray &ray, Hit &hit) const {
-  float b = 2. * ray.direction.dot(ray.origin);
-  float c = (ray.origin).squaredNorm() - m_radius * m_radius;
-  float discr = b * b - 4. * c;
-  if (discr >= 0) {
-    discr = std::sqrt(discr);
-    float t = 0.5 * (-b - discr);
-    if (t < Epsilon)
-      t = 0.5 * (-b + discr);
-    if (t < Epsilon || t > hit.t)
-      return false;
-
-    hit.t = t;
-
-    if (ray.shadowRay)
-      return true;
-
-    Point3f point = ray.at(t);
-    Normal3f n = point.normalized();
-    Vector3f x = Vector3f(0, 1, 0) - Vector3f(0, 1, 0).dot(n) * n;
-    x.normalize();
-    Vector3f y = n.cross(x);
-    hit.localFrame = Frame(x, y, n);
-
-    // Texture coordinates
-    float phi = std::atan2(point.y(), point.x());
-    if (phi < 0.f) phi += 2.f * M_PI;
-    float theta = std::acos(clamp(point.z() / m_radius, -1.f, 1.f));
-    hit.uv = Point2f(phi / (2.f * M_PI), theta / M_PI);
-    return true;
-  }
-  return false;
+  float t;
+  if (!intersectDistance(ray, hit.t, t))
+    return false;
+  hit.t = t;
+  return true;
+}
+
+void Sphere::computeSurfaceInteraction(const Ray &ray, Hit &hit) const {
+  Point3f point = ray.at(hit.t);
+  Normal3f n = point.normalized();
+  Vector3f x = Vector3f(0, 1, 0) - Vector3f(0, 1, 0).dot(n) * n;
+  x.normalize();
+  Vector3f y = n.cross(x);
+  hit.localFrame = Frame(x, y, n);
+
+  // Texture coordinates
+  float phi = std::atan2(point.y(), point.x());
+  if (phi < 0.f) phi += 2.f * M_PI;
+  float theta = std::acos(clamp(point.z() / m_radius, -1.f, 1.f));
+  hit.uv = Point2f(phi / (2.f * M_PI), theta / M_PI);
 }
 
 void Sphere::sample(const Point2f &sample, Point3f &p, Normal3f &n,
@@ -0,0 +1,151 @@
+#include <shapes/mesh.h>
+#include <accelerators/bvhcache.h>
+#include <pcg32.h>
+
+/**
+ * Test of the on-disk BVH cache (BVHCache)
+ *
+ * The BVH of each mesh is built with the cache enabled in the directory
+ * <string name="directory" value="..."/>: the entry stored (or found) by this
+ * build must be read back by a BVHCache of the same key, and the hits of the
+ * mesh built again from the cache must match the hits of a BVH built without
+ * the cache. The entry must not be used by another version of the mesh
+ * loader.
+ */
+class BVHCacheTest : public Object {
+public:
+    BVHCacheTest(const PropertyList &propList) {
+        /* Directory of the cache entries written by the test */
+        m_directory = propList.getString("directory", "bvhcache-test");
+
+        /* Number of random rays traced through each mesh */
+        m_rayCount = propList.getInteger("rayCount", 100000);
+    }
+
+    virtual ~BVHCacheTest() {
+        for (auto mesh : m_meshes)
+            delete mesh;
+    }
+
+    void addChild(Object *obj) {
+        Mesh *mesh = dynamic_cast<Mesh *>(obj);
+        if (!mesh)
+            throw RTException("BVHCacheTest::addChild(<%s>) expects a mesh!",
+                classTypeName(obj->getClassType()));
+        m_meshes.push_back(mesh);
+    }
+
+    /// Run the tests on each mesh
+    void activate() {
+        int total = 0, passed = 0;
+        std::string previousDirectory = BVHCache::directory();
+        for (auto mesh : m_meshes) {
+            cout << "------------------------------------------------------" << endl;
+            cout << "Testing BVH cache: " << mesh->toString() << endl;
+            if (mesh->filePath().empty())
+                throw RTException("BVHCacheTest: the mesh has no file!");
+
+            /* Reference, without the cache */
+            BVHCache::setDirectory("");
+            mesh->buildAccelerator();
+            if (!mesh->bvh())
+                throw RTException("BVHCacheTest: the mesh has no BVH!");
+            std::vector<Ray> rays = sampleRays(mesh->getBoundingBox());
+            std::vector<Hit> reference = traceRays(mesh, rays);
+            float referenceCost = mesh->bvh()->sahCost();
+
+            /* Entry written by the first build, read back */
+            BVHCache::setDirectory(m_directory);
+            mesh->buildAccelerator();
+            BVHCache cache(mesh->filePath(), Mesh::LoaderVersion,
+                           mesh->buildParams());
+            BVH cached;
+            bool loaded = cache.load(cached, mesh->nbFaces());
+            ++total;
+            if (loaded && cached.sahCost() == referenceCost)
+                ++passed;
+            cout << (loaded ? "Accepted" : "Rejected")
+                 << ": entry read back, SAH cost " << cached.sahCost()
+                 << " (built: " << referenceCost << ")" << endl;
+
+            /* Mesh built from the entry */
+            mesh->buildAccelerator();
+            ++total;
+            if (compareHits(reference, traceRays(mesh, rays), "cached BVH"))
+                ++passed;
+
+            /* Entry of another loader version */
+            BVHCache otherLoader(mesh->filePath(), Mesh::LoaderVersion + 1,
+                                 mesh->buildParams());
+            BVH other;
+            bool stale = otherLoader.load(other, mesh->nbFaces());
+            ++total;
+            if (!stale)
+                ++passed;
+            cout << (stale ? "Rejected" : "Accepted")
+                 << ": entry ignored by another loader version" << endl;
+        }
+        BVHCache::setDirectory(previousDirectory);
+        cout << "Passed " << passed << "/" << total << " tests." << endl;
+    }
+
+    std::string toString() const {
+        return tfm::format(
+            "BVHCacheTest[\n"
+            "  directory = \"%s\",\n"
+            "  rayCount = %i\n"
+            "]",
+            m_directory,
+            m_rayCount
+        );
+    }
+
+    EClassType getClassType() const { return ETest; }
+private:
+    /// Rays from a sphere around \a box toward random points of the box
+    std::vector<Ray> sampleRays(const BoundingBox3f &box) const {
+        pcg32 random;
+        std::vector<Ray> rays;
+        Point3f center = box.getCenter();
+        float radius = box.getExtents().norm();
+        for (int i = 0; i < m_rayCount; ++i) {
+            Vector3f d(random.nextFloat() - .5f, random.nextFloat() - .5f,
+                       random.nextFloat() - .5f);
+            Point3f origin = center + radius * d.normalized();
+            Point3f target = box.min + Vector3f(random.nextFloat(),
+                random.nextFloat(), random.nextFloat()).cwiseProduct(box.getExtents());
+            rays.push_back(Ray(origin, (target - origin).normalized()));
+        }
+        return rays;
+    }
+
+    static std::vector<Hit> traceRays(const Mesh *mesh, const std::vector<Ray> &rays) {
+        std::vector<Hit> hits(rays.size());
+        for (size_t i = 0; i < rays.size(); ++i)
+            mesh->intersect(rays[i], hits[i]);
+        return hits;
+    }
+
+    /// \returns true if the hits are on the same triangles at the same distances
+    static bool compareHits(const std::vector<Hit> &reference,
+                            const std::vector<Hit> &hits, const char *what) {
+        int mismatches = 0;
+        for (size_t i = 0; i < hits.size(); ++i) {
+            const Hit &a = reference[i], &b = hits[i];
+            if (a.foundIntersection() != b.foundIntersection() ||
+                (a.foundIntersection() &&
+                 (a.t != b.t || a.primitiveId != b.primitiveId)))
+                ++mismatches;
+        }
+        cout << (mismatches == 0 ? "Accepted" : "Rejected") << ": " << what
+             << ", " << mismatches << "/" << hits.size()
+             << " rays hit differently" << endl;
+        return mismatches == 0;
+    }
+
+    std::vector<Mesh *> m_meshes;
+    std::string m_directory;
+    int m_rayCount;
+};
+
+REGISTER_CLASS(BVHCacheTest, "bvhcachetest");
@@ -0,0 +1,146 @@
+#include <shapes/mesh.h>
+#include <pcg32.h>
+
+/**
+ * Test of the BVH refitting (Mesh::setPositions())
+ *
+ * The vertices of each mesh are first set to their own positions: the hits
+ * of random rays must not change, nor the SAH cost of the refitted BVH fall
+ * below its cost after the construction. The vertices are then displaced by
+ * a smooth wave: the hits of the refitted BVH must match the hits of a BVH
+ * rebuilt over the displaced mesh.
+ *
+ * Give the meshes a large <float name="bvhRebuildThreshold"/> so that
+ * Mesh::setPositions() refits their BVH instead of rebuilding it.
+ */
+class RefitTest : public Object {
+public:
+    RefitTest(const PropertyList &propList) {
+        /* Number of random rays traced through each mesh */
+        m_rayCount = propList.getInteger("rayCount", 100000);
+
+        /* Amplitude of the displacement, relative to the mesh extent */
+        m_displacement = propList.getFloat("displacement", 0.05f);
+    }
+
+    virtual ~RefitTest() {
+        for (auto mesh : m_meshes)
+            delete mesh;
+    }
+
+    void addChild(Object *obj) {
+        Mesh *mesh = dynamic_cast<Mesh *>(obj);
+        if (!mesh)
+            throw RTException("RefitTest::addChild(<%s>) expects a mesh!",
+                classTypeName(obj->getClassType()));
+        mesh->prepareAccelerator();
+        m_meshes.push_back(mesh);
+    }
+
+    /// Run the tests on each mesh
+    void activate() {
+        int total = 0, passed = 0;
+        for (auto mesh : m_meshes) {
+            cout << "------------------------------------------------------" << endl;
+            cout << "Testing refit: " << mesh->toString() << endl;
+            if (!mesh->bvh())
+                throw RTException("RefitTest: the mesh has no BVH!");
+
+            std::vector<Ray> rays = sampleRays(mesh->getBoundingBox());
+            std::vector<Hit> before = traceRays(mesh, rays);
+            float buildCost = mesh->bvh()->sahCost();
+
+            /* Unchanged positions */
+            std::vector<Point3f> positions;
+            for (const Mesh::Vertex &v : mesh->vertices())
+                positions.push_back(v.position);
+            mesh->setPositions(positions);
+            float degradation = mesh->bvh()->sahCost() / buildCost;
+            ++total;
+            if (degradation >= 1.f - 1e-4f &&
+                compareHits(before, traceRays(mesh, rays), "unchanged positions"))
+                ++passed;
+            cout << "SAH cost after the refit in place: x" << degradation << endl;
+
+            /* Displaced positions */
+            const BoundingBox3f &box = mesh->getBoundingBox();
+            Vector3f extent = box.getExtents();
+            float amplitude = m_displacement * extent.maxCoeff();
+            for (Point3f &p : positions) {
+                Vector3f x = (p - box.min).cwiseQuotient(extent.cwiseMax(Epsilon));
+                p += amplitude * Vector3f(std::sin(2 * M_PI * x.y()),
+                                          std::sin(2 * M_PI * x.z()),
+                                          std::sin(2 * M_PI * x.x()));
+            }
+            mesh->setPositions(positions);
+            rays = sampleRays(mesh->getBoundingBox());
+            std::vector<Hit> refitted = traceRays(mesh, rays);
+            mesh->buildAccelerator();
+            ++total;
+            if (compareHits(traceRays(mesh, rays), refitted,
+                            "displaced positions"))
+                ++passed;
+        }
+        cout << "Passed " << passed << "/" << total << " tests." << endl;
+    }
+
+    std::string toString() const {
+        return tfm::format(
+            "RefitTest[\n"
+            "  rayCount = %i,\n"
+            "  displacement = %f\n"
+            "]",
+            m_rayCount,
+            m_displacement
+        );
+    }
+
+    EClassType getClassType() const { return ETest; }
+private:
+    /// Rays from a sphere around \a box toward random points of the box
+    std::vector<Ray> sampleRays(const BoundingBox3f &box) const {
+        pcg32 random;
+        std::vector<Ray> rays;
+        Point3f center = box.getCenter();
+        float radius = box.getExtents().norm();
+        for (int i = 0; i < m_rayCount; ++i) {
+            Vector3f d(random.nextFloat() - .5f, random.nextFloat() - .5f,
+                       random.nextFloat() - .5f);
+            Point3f origin = center + radius * d.normalized();
+            Point3f target = box.min + Vector3f(random.nextFloat(),
+                random.nextFloat(), random.nextFloat()).cwiseProduct(box.getExtents());
+            rays.push_back(Ray(origin, (target - origin).normalized()));
+        }
+        return rays;
+    }
+
+    static std::vector<Hit> traceRays(const Mesh *mesh, const std::vector<Ray> &rays) {
+        std::vector<Hit> hits(rays.size());
+        for (size_t i = 0; i < rays.size(); ++i)
+            mesh->intersect(rays[i], hits[i]);
+        return hits;
+    }
+
+    /// \returns true if the hits are at the same distances
+    static bool compareHits(const std::vector<Hit> &reference,
+                            const std::vector<Hit> &hits, const char *what) {
+        int mismatches = 0;
+        for (size_t i = 0; i < hits.size(); ++i) {
+            const Hit &a = reference[i], &b = hits[i];
+            if (a.foundIntersection() != b.foundIntersection() ||
+                (a.foundIntersection() &&
+                 std::abs(a.t - b.t) > 1e-5f * std::max(1.f, a.t)))
+                ++mismatches;
+        }
+        cout << (mismatches == 0 ? "Accepted" : "Rejected") << ": " << what
+             << ", " << mismatches << "/" << hits.size()
+             << " rays hit differently" << endl;
+        return mismatches == 0;
+    }
+
+    std::vector<Mesh *> m_meshes;
+    int m_rayCount;
+    float m_displacement;
+};
+
+REGISTER_CLASS(RefitTest, "refittest");
@@ -40,7 +40,8 @@
  *    into a certain direction matches a given value (modulo noise).
  *
  * 2. that the average radiance received by a camera within some scene
- *    matches a given value (modulo noise).
+ *    matches a given value (modulo noise). The camera rays are traced by
+ *    packets when the integrator has a packetSize.
  */
 class StudentsTTest : public Object {
 public:
@@ -151,22 +152,53 @@ public:
                 cout << "Generating " << m_sampleCount << " paths.. " << endl;
 
                 double mean = 0, variance = 0;
-                for (int k=0; k<m_sampleCount; ++k) {
-                    /* Sample a ray from the camera */
-                    Ray ray;
-                    Point2f pixelSample = (sampler->next2D().array()
-                        * camera->getOutputSize().cast<float>().array()).matrix();                    
-                    camera->sampleRay(ray, pixelSample);
-
-                    /* Compute the incident radiance */
-                    Color3f value = integrator->Li(scene, sampler, ray);
-
+                int k = 0;
+                auto addPath = [&](const Color3f &value) {
                     /* Numerically robust online variance estimation using an
                        algorithm proposed by Donald Knuth (TAOCP vol.2, 3rd ed., p.232) */
                     double result = (double) value.getLuminance();
                     double delta = result - mean;
                     mean += delta / (double) (k+1);
                     variance += delta * (result - mean);
+                    ++k;
+                };
+                auto samplePixel = [&]() {
+                    return Point2f((sampler->next2D().array()
+                        * camera->getOutputSize().cast<float>().array()).matrix());
+                };
+
+                int packetSize = integrator->packetSize();
+                if (packetSize == 0) {
+                    while (k < m_sampleCount) {
+                        /* Sample a ray from the camera */
+                        Ray ray;
+                        camera->sampleRay(ray, samplePixel());
+
+                        /* Compute the incident radiance */
+                        addPath(integrator->Li(scene, sampler, ray));
+                    }
+                } else {
+                    /* Trace the camera rays by packets, as the renderer does,
+                       with the samples of each lane drawn beforehand */
+                    int samples2D = integrator->packetSamples2D();
+                    RayPacket packet(packetSize);
+                    Point2f positions[RayPacket::MaxSize];
+                    Color3f radiance[RayPacket::MaxSize];
+                    std::vector<Point2f> laneSamples(packetSize * samples2D);
+                    while (k < m_sampleCount) {
+                        int lanes = std::min(packetSize, m_sampleCount - k);
+                        packet.activeMask = 0;
+                        for (int lane = 0; lane < lanes; ++lane) {
+                            packet.activeMask |= 1u << lane;
+                            positions[lane] = samplePixel();
+                            for (int i = 0; i < samples2D; ++i)
+                                laneSamples[lane * samples2D + i] = sampler->next2D();
+                        }
+                        camera->sampleRays(packet, positions);
+                        integrator->LiPacket(scene, packet, laneSamples.data(), radiance);
+                        for (int lane = 0; lane < lanes; ++lane)
+                            addPath(radiance[lane]);
+                    }
                 }
                 variance /= m_sampleCount - 1;
 